@@ -284,6 +284,35 @@ function JanoshClass.request_t(self, req)
   return janosh_request_t(req)
 end
 
+-- sends a request without waiting for its response. only inside of a transaction.
+function JanoshClass.submit(self, req)
+  table.insert(req,1,debug.traceback())
+  return janosh_submit(req)
+end
+
+-- receives the response of the oldest submitted request
+function JanoshClass.collect(self)
+  return janosh_collect()
+end
+
+-- sends a list of requests back to back and returns their responses as {rc, value} in order
+function JanoshClass.pipeline(self, reqs)
+  local submitted = 0
+  for i, req in ipairs(reqs) do
+    if not self:submit(req) then
+      break
+    end
+    submitted = submitted + 1
+  end
+
+  local results = {}
+  for i = 1, submitted do
+    local ret, val = self:collect()
+    results[i] = {ret, val}
+  end
+  return results
+end
+
 function JanoshClass.load(self, value)
   local ret, value = self:request({"load",value})
   return ret
@@ -321,6 +350,35 @@ function JanoshClass.set_all(self, argv)
   return ret
 end
 
+-- executes a list of operations like {{"set", "/a", 1}, {"remove", "/b"}} in one request
+-- and returns their results as {rc, value} in order. rc is 0 on success.
+-- "trigger" sets a value and publishes the change.
+function JanoshClass.batch(self, ops)
+  local req = {"batch"}
+  for i, op in ipairs(ops) do
+    table.insert(req, op[1])
+    -- a string, lua numbers are sent as decimals
+    table.insert(req, tostring(#op - 1))
+    for j = 2, #op do
+      table.insert(req, op[j])
+    end
+  end
+
+  local ret, val = self:request(req)
+  local results = {}
+  local pos = 1
+  while val ~= nil and pos <= #val do
+    local s, e, rc, len = string.find(val, "^(%d+) (%d+)\n", pos)
+    if s == nil then
+      break
+    end
+    len = tonumber(len)
+    table.insert(results, {tonumber(rc), string.sub(val, e + 1, e + len)})
+    pos = e + len + 1
+  end
+  return results
+end
+
 function JanoshClass.add(self, key, value)
   local ret, val = self:request({"add",key,value})
   return ret
@@ -419,16 +477,30 @@ function JanoshClass.raw(self, key)
 
 end
 
-function JanoshClass.getJson(self, keys)
+-- appends get options like {offset=100, limit=50, reverse=true, fields={"name", "address/city"}} to a request as name=value arguments
+function appendGetOptions(req, opts)
+  if opts ~= nil then
+    for k, v in pairs(opts) do
+      if type(v) == "table" then
+        table.insert(req, k .. "=" .. table.concat(v, ","))
+      else
+        table.insert(req, k .. "=" .. tostring(v))
+      end
+    end
+  end
+  return req
+end
+
+function JanoshClass.getJson(self, keys, opts)
   if type(keys) == "table" then
         table.insert(keys, 1, "get")
-        local err, value = self:request(keys)
+        local err, value = self:request(appendGetOptions(keys, opts))
         if not err then
                 return nil
         end
 	return value;
   else
-	local err, value = self:request({"get", keys})
+	local err, value = self:request(appendGetOptions({"get", keys}, opts))
 	if not err then
 		return nil
 	end
@@ -436,10 +508,10 @@ function JanoshClass.getJson(self, keys)
   end
 end
 
-function JanoshClass.get(self, keys)
+function JanoshClass.get(self, keys, opts)
   if type(keys) == "table" then
     	table.insert(keys, 1, "get")
-	local err, value = self:request(keys)
+	local err, value = self:request(appendGetOptions(keys, opts))
 	if not err or value == "" then
 		return nil
 	end
@@ -462,7 +534,7 @@ function JanoshClass.get(self, keys)
 		return table;
 	end	
   else
-    local err, value = self:request({"get", keys})
+    local err, value = self:request(appendGetOptions({"get", keys}, opts))
     if not err or value == "" then
       return nil
     end
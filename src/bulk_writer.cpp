@@ -0,0 +1,56 @@
+#include "bulk_writer.hpp"
+#include "exception.hpp"
+#include "tracker.hpp"
+
+namespace janosh {
+
+  BulkWriter::BulkWriter(StorageBackend* backend, const size_t batchSize) :
+      backend_(backend),
+      batchSize_(batchSize > 0 ? batchSize : 1),
+      written_(0) {
+  }
+
+  void BulkWriter::set(const string& key, const string& value) {
+    sets_[key] = value;
+    if(pending() >= batchSize_)
+      flush();
+  }
+
+  void BulkWriter::remove(const string& key) {
+    removes_.push_back(key);
+    if(pending() >= batchSize_)
+      flush();
+  }
+
+  void BulkWriter::flush() {
+    if(!sets_.empty()) {
+      if(backend_->set_bulk(sets_) != static_cast<int64_t>(sets_.size()))
+        throw db_exception() << string_info({"bulk set failed", sets_.begin()->first});
+      written_ += sets_.size();
+    }
+
+    if(!removes_.empty()) {
+      if(backend_->remove_bulk(removes_) < 0)
+        throw db_exception() << string_info({"bulk remove failed", removes_.front()});
+      written_ += removes_.size();
+    }
+
+    //removes are settled first. a key that was re-encoded is removed and set under the same pretty path.
+    Tracker* tracker = Tracker::getInstancePerThread();
+    for(const string& k : removes_)
+      tracker->settle(Path(k).pretty(), "", Tracker::DELETE);
+    for(auto& p : sets_)
+      tracker->settle(Path(p.first).pretty(), p.second, Tracker::WRITE);
+
+    sets_.clear();
+    removes_.clear();
+  }
+
+  size_t BulkWriter::pending() const {
+    return sets_.size() + removes_.size();
+  }
+
+  size_t BulkWriter::written() const {
+    return written_;
+  }
+}
@@ -0,0 +1,37 @@
+#ifndef _JANOSH_BULK_WRITER_HPP
+#define _JANOSH_BULK_WRITER_HPP
+
+#include <map>
+#include <vector>
+#include <string>
+#include "storage_backend.hpp"
+
+namespace janosh {
+  using std::string;
+
+  /**
+   * Accumulates writes and flushes them to the backend with set_bulk/remove_bulk
+   * once batchSize operations are pending.
+   * Pending sets are written before pending removes, so a batch must not
+   * set and remove the same key.
+   * The writes are settled with the Tracker once they reached the backend.
+   */
+  class BulkWriter {
+    StorageBackend* backend_;
+    size_t batchSize_;
+    std::map<string, string> sets_;
+    std::vector<string> removes_;
+    size_t written_;
+  public:
+    BulkWriter(StorageBackend* backend, const size_t batchSize);
+
+    void set(const string& key, const string& value);
+    void remove(const string& key);
+    void flush();
+
+    size_t pending() const;
+    size_t written() const;
+  };
+}
+
+#endif
@@ -0,0 +1,37 @@
+#include "chunked_stream.hpp"
+
+namespace janosh {
+
+  ChunkedStreamBuf::ChunkedStreamBuf(Sink sink, const size_t chunkSize) :
+      sink_(sink),
+      buffer_(chunkSize > 0 ? chunkSize : 1) {
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+  }
+
+  void ChunkedStreamBuf::finish() {
+    size_t len = pptr() - pbase();
+    if(len > 0) {
+      sink_(pbase(), len);
+      setp(buffer_.data(), buffer_.data() + buffer_.size());
+    }
+  }
+
+  ChunkedStreamBuf::int_type ChunkedStreamBuf::overflow(int_type c) {
+    finish();
+    if(!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  ChunkedOStream::ChunkedOStream(ChunkedStreamBuf::Sink sink, const size_t chunkSize) :
+      std::ostream(NULL),
+      buf_(sink, chunkSize) {
+    this->rdbuf(&buf_);
+  }
+
+  void ChunkedOStream::finish() {
+    buf_.finish();
+  }
+}
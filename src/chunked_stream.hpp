@@ -0,0 +1,59 @@
+#ifndef _JANOSH_CHUNKED_STREAM_HPP
+#define _JANOSH_CHUNKED_STREAM_HPP
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+namespace janosh {
+
+  /**
+   * Marks a response frame as a chunk of command output that is followed by more frames.
+   */
+  const uint32_t RESPONSE_MORE = 1;
+
+  /**
+   * The binary header in front of every response frame, followed by length bytes of payload.
+   * Frames flagged with RESPONSE_MORE carry a chunk of the command output.
+   * The last frame of a response isn't flagged and carries the return code of the command.
+   * Seq repeats the sequence number of the request the frame belongs to.
+   */
+  struct ResponseHeader {
+    uint64_t length;
+    int32_t status;
+    uint32_t flags;
+    uint64_t seq;
+  };
+
+  /**
+   * A stream buffer that hands its content to a sink whenever chunkSize bytes have been written.
+   * Flushing the stream (e.g. by std::endl) doesn't emit a chunk, only finish() does.
+   */
+  class ChunkedStreamBuf : public std::streambuf {
+  public:
+    typedef std::function<void(const char*, size_t)> Sink;
+  private:
+    Sink sink_;
+    std::vector<char> buffer_;
+  protected:
+    virtual int_type overflow(int_type c) override;
+  public:
+    ChunkedStreamBuf(Sink sink, const size_t chunkSize);
+    void finish();
+  };
+
+  class ChunkedOStream : public std::ostream {
+    ChunkedStreamBuf buf_;
+  public:
+    ChunkedOStream(ChunkedStreamBuf::Sink sink, const size_t chunkSize);
+
+    /**
+     * Hands the buffered rest of the output to the sink.
+     */
+    void finish();
+  };
+}
+
+#endif
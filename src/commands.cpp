@@ -1,8 +1,11 @@
 #include "commands.hpp"
 #include "exception.hpp"
 #include "request.hpp"
+#include "tracker.hpp"
 #include <sys/stat.h>
 #include <sstream>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 
 namespace janosh {
 
@@ -19,7 +22,7 @@ public:
       std::vector<Record> recs;
       for (size_t i = 0; i < params.size() -1; ++i)  {
         const Value& p = params[i];
-        recs.push_back(RecordPool::get(p.str()));
+        recs.push_back(RecordPool::get(janosh->resolve(p.str())));
       }
 
       if (!janosh->filter(recs, params.back().str(), out))
@@ -36,14 +39,14 @@ public:
 
   virtual Result operator()(const std::vector<Value>& params, std::ostream& out) {
     if (params.size() == 1) {
-      Record rec = RecordPool::get(params[0].str());
+      Record rec = RecordPool::get(janosh->resolve(params[0].str()));
       if(rec.isDirectory()) {
         return {janosh->random(rec, out), "Successful"};
       }
       else
         return {-1, "Expected a directory"};
     } else if(params.size() == 2) {
-      Record rec = RecordPool::get(params[0].str());
+      Record rec = RecordPool::get(janosh->resolve(params[0].str()));
       if(rec.isDirectory()) {
         return {janosh->random(rec, params[1].str(), out), "Successful"};
       }
@@ -63,7 +66,7 @@ public:
 
   virtual Result operator()(const std::vector<Value>& params, std::ostream& out) {
     if (params.size() == 1) {
-      Record rec = RecordPool::get(params[0].str());
+      Record rec = RecordPool::get(janosh->resolve(params[0].str()));
       rec.fetch();
       if(rec.exists())
         return {1, "Successful"};
@@ -87,7 +90,7 @@ public:
       for(const Value& p : params) {
         LOG_DEBUG_MSG("Removing", p.str());
 //FIXME use cursors for batch operations
-        Record path = RecordPool::get(p.str());
+        Record path = RecordPool::get(janosh->resolve(p.str()));
         cnt += janosh->remove(path);
         LOG_DEBUG(cnt);
       }
@@ -122,6 +125,28 @@ inline bool file_exists (const std::string& name) {
   return (stat (name.c_str(), &buffer) == 0);
 }
 
+/**
+ * Parses a count argument. Signs, fractions and any other characters than digits are rejected.
+ * @param name the name of the argument, used in the error message.
+ * @param value the argument.
+ * @return the count.
+ */
+inline size_t parse_count(const std::string& name, const std::string& value) {
+  if(value.empty() || value.find_first_not_of("0123456789") != string::npos)
+    throw janosh_exception() << string_info({"invalid " + name, value});
+
+  try {
+    return boost::lexical_cast<size_t>(value);
+  } catch(boost::bad_lexical_cast& ex) {
+    throw janosh_exception() << string_info({"invalid " + name, value});
+  }
+}
+
+/**
+ * The document commands patch, load and import take json documents inline or as paths of files
+ * the daemon reads. An inline document travels with the request, so it is limited by the
+ * connectionBufferSize of the daemon (64MB by default). Larger documents have to be passed as files.
+ */
 class PatchCommand: public Command {
 public:
   explicit PatchCommand(janosh::Janosh* janosh) :
@@ -168,6 +193,28 @@ public:
   }
 };
 
+class ImportCommand: public Command {
+public:
+  explicit ImportCommand(janosh::Janosh* janosh) :
+      Command(janosh) {
+  }
+
+  virtual Result operator()(const vector<Value>& params, std::ostream& out) {
+    if (params.empty() || params.size() > 2)
+      return {-1, "Expected a json file or document and an optional target directory"};
+
+    Record target = RecordPool::get(janosh->resolve(params.size() == 2 ? params[1].str() : "/."));
+    size_t cnt;
+    if(file_exists(params[0].str())) {
+      cnt = janosh->import(params[0].str(), target);
+    } else {
+      std::stringstream ss(params[0].str());
+      cnt = janosh->import(ss, target);
+    }
+    return {cnt, "Successful"};
+  }
+};
+
 class MakeArrayCommand: public Command {
 public:
   explicit MakeArrayCommand(janosh::Janosh* janosh) :
@@ -178,7 +225,7 @@ public:
     if (params.size() != 1)
       return {-1, "Expected one path"};
 
-    if (janosh->makeArray(RecordPool::get(params.front().str())))
+    if (janosh->makeArray(RecordPool::get(janosh->resolve(params.front().str()))))
       return {1, "Successful"};
     else
       return {-1, "Failed"};
@@ -195,7 +242,7 @@ public:
     if (params.size() != 1)
       return {-1, "Expected one path"};
 
-    if (janosh->makeObject(RecordPool::get(params.front().str())))
+    if (janosh->makeObject(RecordPool::get(janosh->resolve(params.front().str()))))
       return {1, "Successful"};
     else
       return {-1, "Failed"};
@@ -253,7 +300,7 @@ public:
       const string path = params.front().str();
 
       for (auto it = params.begin(); it != params.end(); it += 2) {
-        if (!janosh->add(RecordPool::get((*it).str()), (*(it + 1))))
+        if (!janosh->add(RecordPool::get(janosh->resolve((*it).str())), (*(it + 1))))
           return {-1, "Failed"};
       }
 
@@ -274,7 +321,7 @@ public:
     } else {
 
       for (auto it = params.begin(); it != params.end(); it += 2) {
-        if (!janosh->replace(RecordPool::get((*it).str()), (*(it + 1))))
+        if (!janosh->replace(RecordPool::get(janosh->resolve((*it).str())), (*(it + 1))))
           return {-1, "Failed"};
       }
 
@@ -296,7 +343,7 @@ public:
 
       size_t cnt = 0;
       for (auto it = params.begin(); it != params.end(); it += 2) {
-        cnt += janosh->set(RecordPool::get((*it).str()), (*(it + 1)));
+        cnt += janosh->set(RecordPool::get(janosh->resolve((*it).str())), (*(it + 1)));
       }
 
       if (cnt == 0)
@@ -317,8 +364,8 @@ public:
     if (params.size() != 2) {
       return {-1, "Expected two paths"};
     } else {
-      Record src = RecordPool::get(params.front().str());
-      Record dest = RecordPool::get(params.back().str());
+      Record src = RecordPool::get(janosh->resolve(params.front().str()));
+      Record dest = RecordPool::get(janosh->resolve(params.back().str()));
       src.fetch();
 
       if (!src.exists())
@@ -343,8 +390,8 @@ public:
     if (params.size() != 2) {
       return {-1, "Expected two paths"};
     } else {
-      Record src = RecordPool::get(params.front().str());
-      Record dest = RecordPool::get(params.back().str());
+      Record src = RecordPool::get(janosh->resolve(params.front().str()));
+      Record dest = RecordPool::get(janosh->resolve(params.back().str()));
       src.fetch();
 
       if (!src.exists())
@@ -369,8 +416,8 @@ public:
     if (params.size() != 2) {
       return {-1, "Expected two paths"};
     } else {
-      Record src = RecordPool::get(params.front().str());
-      Record dest = RecordPool::get(params.back().str());
+      Record src = RecordPool::get(janosh->resolve(params.front().str()));
+      Record dest = RecordPool::get(janosh->resolve(params.back().str()));
       src.fetch();
 
       if (!src.exists())
@@ -395,7 +442,7 @@ public:
     if (params.size() < 2) {
       return {-1, "Expected a path and a list of values"};
     } else {
-      Record target = RecordPool::get(params.front().str());
+      Record target = RecordPool::get(janosh->resolve(params.front().str()));
       size_t cnt = janosh->append(params.begin() + 1, params.end(), target);
       return {cnt, "Successful"};
     }
@@ -418,6 +465,158 @@ public:
   }
 };
 
+class SetRawCommand: public Command {
+public:
+  explicit SetRawCommand(janosh::Janosh* janosh) :
+      Command(janosh) {
+  }
+
+  virtual Result operator()(const vector<Value>& params, std::ostream& out) {
+    if (params.empty() || params.size() % 2 != 0) {
+      return {-1, "Expected a list of key/value pairs"};
+    } else {
+      std::map<string, string> recs;
+      for (auto it = params.begin(); it != params.end(); it += 2) {
+        recs[(*it).str()] = (*(it + 1)).str();
+      }
+
+      return {janosh->setRaw(recs), "Successful"};
+    }
+  }
+};
+
+class MigrateCommand: public Command {
+public:
+  explicit MigrateCommand(janosh::Janosh* janosh) :
+      Command(janosh) {
+  }
+
+  virtual Result operator()(const vector<Value>& params, std::ostream& out) {
+    if (!params.empty()) {
+      return {-1, "Migrate doesn't take any parameters"};
+    } else {
+      size_t n = janosh->migrate();
+      out << n << '\n';
+      return {n, "Successful"};
+    }
+  }
+};
+
+class StatsCommand: public Command {
+public:
+  explicit StatsCommand(janosh::Janosh* janosh) :
+      Command(janosh) {
+  }
+
+  virtual Result operator()(const vector<Value>& params, std::ostream& out) {
+    if (!params.empty())
+      return {-1, "Stats doesn't take any parameters"};
+
+    return {janosh->stats(out), "Successful"};
+  }
+};
+
+class QueryCommand: public Command {
+public:
+  explicit QueryCommand(janosh::Janosh* janosh) :
+      Command(janosh) {
+  }
+
+  virtual Result operator()(const vector<Value>& params, std::ostream& out) {
+    if (params.size() == 2) {
+      return {janosh->query(params[0].str(), params[1].str(), params[1].str(), out), "Successful"};
+    } else if (params.size() == 3) {
+      return {janosh->query(params[0].str(), params[1].str(), params[2].str(), out), "Successful"};
+    } else {
+      return {-1, "Expected an index pattern and a value or a value range"};
+    }
+  }
+};
+
+class BuildIndexCommand: public Command {
+public:
+  explicit BuildIndexCommand(janosh::Janosh* janosh) :
+      Command(janosh) {
+  }
+
+  virtual Result operator()(const vector<Value>& params, std::ostream& out) {
+    if (params.size() != 1)
+      return {-1, "Expected an index pattern"};
+
+    size_t n = janosh->buildIndex(params[0].str());
+    out << n << '\n';
+    return {n, "Successful"};
+  }
+};
+
+/**
+ * Executes a list of operations in one request. The parameters are groups of the form
+ * command, number of arguments, arguments. Every operation is executed even if an earlier one failed.
+ * The output of each operation is preceded by a line holding its status (0 on success) and its length in bytes.
+ * Like a request, "trigger" is a set that publishes its changes.
+ */
+class BatchCommand: public Command {
+  struct Operation {
+    Command* cmd;
+    vector<Value> args;
+    bool trigger;
+  };
+public:
+  explicit BatchCommand(janosh::Janosh* janosh) :
+      Command(janosh) {
+  }
+
+  virtual Result operator()(const vector<Value>& params, std::ostream& out) {
+    vector<Operation> ops;
+    for(size_t i = 0; i < params.size();) {
+      const string name = params[i].str();
+      if(name == "batch")
+        return {-1, "Nested batches aren't supported"};
+
+      const bool trigger = (name == "trigger");
+      auto it = janosh->cm_.find(trigger ? "set" : name);
+      if(it == janosh->cm_.end())
+        return {-1, "Unknown command " + name};
+      if(i + 1 >= params.size())
+        return {-1, "Expected the number of arguments of " + name};
+
+      size_t argc = parse_count("number of arguments of " + name, params[i + 1].str());
+      if(argc > params.size() - i - 2)
+        return {-1, "Missing arguments of " + name};
+
+      ops.push_back({it->second, vector<Value>(params.begin() + i + 2, params.begin() + i + 2 + argc), trigger});
+      i += 2 + argc;
+    }
+
+    if(ops.empty())
+      return {-1, "Expected a list of operations"};
+
+    Tracker* tracker = Tracker::getInstancePerThread();
+    const bool publish = tracker->getDoPublish();
+    std::ostringstream opOut;
+    for(auto& op : ops) {
+      opOut.str("");
+      int status = 1;
+      try {
+        Tracker::setDoPublish(publish || op.trigger);
+        Result r = (*op.cmd)(op.args, opOut);
+        status = (r.first == -1) ? 1 : 0;
+        if(status != 0)
+          LOG_INFO_MSG("Batch operation failed", r.second);
+      } catch(std::exception& ex) {
+        janosh::printException(ex);
+      }
+      Tracker::setDoPublish(publish);
+
+      const string result = opOut.str();
+      out << status << ' ' << result.size() << '\n';
+      out.write(result.data(), result.size());
+    }
+
+    return {ops.size(), "Successful"};
+  }
+};
+
 class SizeCommand: public Command {
 public:
   explicit SizeCommand(janosh::Janosh* janosh) :
@@ -428,7 +627,7 @@ public:
     if (params.size() != 1) {
       return {-1, "Expected a path"};
     } else {
-      Record p = RecordPool::get(params.front().str());
+      Record p = RecordPool::get(janosh->resolve(params.front().str()));
       out << janosh->size(p) << '\n';
     }
     return {0, "Successful"};
@@ -436,30 +635,64 @@ public:
 };
 
 class GetCommand: public Command {
+  /**
+   * Parses a get option of the form name=value.
+   * @return false if the parameter isn't an option but a key.
+   */
+  static bool parseOption(const string& param, GetOptions& options) {
+    size_t eq = param.find('=');
+    if(param.empty() || param.at(0) == '/' || eq == string::npos)
+      return false;
+
+    const string name = param.substr(0, eq);
+    const string value = param.substr(eq + 1);
+    if(name == "offset")
+      options.offset = parse_count(name, value);
+    else if(name == "limit")
+      options.limit = parse_count(name, value);
+    else if(name == "reverse")
+      options.reverse = (value == "true" || value == "1");
+    else if(name == "fields") {
+      vector<string> fields;
+      boost::split(fields, value, boost::is_any_of(","));
+      for(string& f : fields) {
+        boost::trim_if(f, boost::is_any_of("/ "));
+        if(!f.empty())
+          options.fields.push_back(f);
+      }
+    }
+    else
+      throw janosh_exception() << string_info({"unknown get option", name});
+
+    return true;
+  }
 public:
   explicit GetCommand(janosh::Janosh* janosh) :
       Command(janosh) {
   }
 
   Result operator()(const vector<Value>& params, std::ostream& out) {
-    if (params.empty()) {
+    std::vector<Record> recs;
+    GetOptions options;
+    for(const Value& p : params) {
+      if(!parseOption(p.str(), options))
+        recs.push_back(RecordPool::get(janosh->resolve(p.str())));
+    }
+
+    if (recs.empty()) {
       return {-1, "Expected a list of keys"};
     } else {
-      std::vector<Record> recs;
-      for(const Value& p : params) {
-        recs.push_back(RecordPool::get(p.str()));
-      }
-
-      if (!janosh->get(recs, out))
+      if (!janosh->get(recs, out, options))
         return {-1, "Fetching failed"};
     }
-    return {params.size(), "Successful"};
+    return {recs.size(), "Successful"};
   }
 };
 
 CommandMap makeCommandMap(Janosh* janosh) {
   CommandMap cm;
   cm.insert( { "load", new LoadCommand(janosh) });
+  cm.insert( { "import", new ImportCommand(janosh) });
   cm.insert( { "set", new SetCommand(janosh) });
   cm.insert( { "add", new AddCommand(janosh) });
   cm.insert( { "replace", new ReplaceCommand(janosh) });
@@ -480,6 +713,12 @@ CommandMap makeCommandMap(Janosh* janosh) {
   cm.insert( { "random", new RandomCommand(janosh) });
   cm.insert( { "filter", new FilterCommand(janosh) });
   cm.insert( { "patch", new PatchCommand(janosh) });
+  cm.insert( { "migrate", new MigrateCommand(janosh) });
+  cm.insert( { "setraw", new SetRawCommand(janosh) });
+  cm.insert( { "stats", new StatsCommand(janosh) });
+  cm.insert( { "query", new QueryCommand(janosh) });
+  cm.insert( { "buildindex", new BuildIndexCommand(janosh) });
+  cm.insert( { "batch", new BatchCommand(janosh) });
 
   return cm;
 }
@@ -7,6 +7,7 @@
 
 #include <boost/lexical_cast.hpp>
 #include <bitset>
+#include <stdexcept>
 #include "component.hpp"
 
 namespace janosh {
@@ -21,9 +22,8 @@ Component::Component(const string& c) {
       this->_key = "$" + keyEncodeIndex(i);
       this->_pretty = "#" + boost::lexical_cast<string>(i);
     } else if (c.at(0) == '$') {
-      const string enc = c.substr(1);
-      size_t dec = keyDecodeIndex(enc);
-      this->_key = "$" + enc;
+      size_t dec = keyDecodeIndex(c.substr(1));
+      this->_key = "$" + keyEncodeIndex(dec);
       this->_pretty = "#" + boost::lexical_cast<string>(dec);
     } else if (c.at(0) == '.') {
       this->_key = "!";
@@ -38,13 +38,55 @@ Component::Component(const string& c) {
   }
 }
 
+/**
+ * Encodes an array index as a length prefixed hex string.
+ * The prefix character 'A' to 'P' denotes the number of hex digits that follow (1 to 16),
+ * therefore lexical order of encoded indices equals their numeric order.
+ * e.g. 0 -> "A0", 15 -> "Af", 16 -> "B10", 255 -> "Bff", 256 -> "C100"
+ */
 const string Component::keyEncodeIndex(const size_t& n) const {
-  using namespace std;
-  return bitset<std::numeric_limits<size_t>::digits>(n).to_string<char, char_traits<char>, allocator<char> >();
+  static const char* digits = "0123456789abcdef";
+  char buf[std::numeric_limits<size_t>::digits / 4];
+  size_t len = 0;
+  size_t v = n;
+  do {
+    buf[len++] = digits[v & 0xf];
+    v >>= 4;
+  } while(v > 0);
+
+  string enc;
+  enc.reserve(len + 1);
+  enc.push_back('A' + (len - 1));
+  while(len > 0)
+    enc.push_back(buf[--len]);
+  return enc;
 }
 
+/**
+ * Decodes an index encoded by keyEncodeIndex.
+ * Also accepts the legacy 64 character bitset encoding so existing databases can be migrated.
+ */
 const size_t Component::keyDecodeIndex(const string& s) const {
-  return std::bitset<std::numeric_limits<size_t>::digits>(s).to_ulong();
+  using std::invalid_argument;
+  if(s.size() == std::numeric_limits<size_t>::digits) {
+    return std::bitset<std::numeric_limits<size_t>::digits>(s).to_ulong();
+  }
+
+  if(s.size() < 2 || s.at(0) < 'A' || s.at(0) > 'P' || size_t(s.at(0) - 'A' + 1) != s.size() - 1)
+    throw invalid_argument("malformed index encoding: " + s);
+
+  size_t n = 0;
+  for(auto it = s.begin() + 1; it != s.end(); ++it) {
+    const char& c = *it;
+    n <<= 4;
+    if(c >= '0' && c <= '9')
+      n |= (c - '0');
+    else if(c >= 'a' && c <= 'f')
+      n |= (c - 'a' + 10);
+    else
+      throw invalid_argument("malformed index encoding: " + s);
+  }
+  return n;
 }
 
 bool Component::operator==(const Component& other) const {
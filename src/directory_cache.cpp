@@ -0,0 +1,123 @@
+#include "directory_cache.hpp"
+#include "exception.hpp"
+
+namespace janosh {
+
+  DirectoryCache::Scope DirectoryCache::scope_ = DirectoryCache::REQUEST;
+  std::mutex DirectoryCache::instancesMutex_;
+  map<std::thread::id, DirectoryCache*> DirectoryCache::instances_;
+  std::atomic<size_t> DirectoryCache::hits_(0);
+  std::atomic<size_t> DirectoryCache::misses_(0);
+
+  bool DirectoryCache::get(const string& path, Value& value) {
+    if(scope_ == NONE)
+      return false;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = entries_.find(path);
+    if(it == entries_.end()) {
+      ++misses_;
+      return false;
+    }
+
+    ++hits_;
+    value = (*it).second;
+    return true;
+  }
+
+  size_t DirectoryCache::generation() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return generation_;
+  }
+
+  void DirectoryCache::put(const string& path, const Value& value, const size_t generation) {
+    if(scope_ == NONE)
+      return;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(generation_ != generation)
+      return;
+
+    entries_[path] = value;
+  }
+
+  void DirectoryCache::erase(const string& path) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++generation_;
+    entries_.erase(path);
+  }
+
+  void DirectoryCache::clear() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++generation_;
+    entries_.clear();
+  }
+
+  void DirectoryCache::beginRequest() {
+    if(scope_ != WORKER)
+      clear();
+  }
+
+  DirectoryCache* DirectoryCache::getInstancePerThread() {
+    std::thread::id tid = std::this_thread::get_id();
+    std::unique_lock<std::mutex> lock(instancesMutex_);
+    auto it = instances_.find(tid);
+    if(it != instances_.end())
+      return (*it).second;
+
+    DirectoryCache* instance = new DirectoryCache();
+    instances_[tid] = instance;
+    return instance;
+  }
+
+  void DirectoryCache::removeInstancePerThread() {
+    std::unique_lock<std::mutex> lock(instancesMutex_);
+    auto it = instances_.find(std::this_thread::get_id());
+    if(it != instances_.end()) {
+      delete (*it).second;
+      instances_.erase(it);
+    }
+  }
+
+  void DirectoryCache::invalidate(const string& path) {
+    if(scope_ == WORKER) {
+      std::unique_lock<std::mutex> lock(instancesMutex_);
+      for(auto& p : instances_)
+        p.second->erase(path);
+    } else if(scope_ == REQUEST) {
+      std::unique_lock<std::mutex> lock(instancesMutex_);
+      auto it = instances_.find(std::this_thread::get_id());
+      if(it != instances_.end())
+        (*it).second->erase(path);
+    }
+  }
+
+  void DirectoryCache::invalidateAll() {
+    std::unique_lock<std::mutex> lock(instancesMutex_);
+    for(auto& p : instances_)
+      p.second->clear();
+  }
+
+  void DirectoryCache::setScope(const string& scope) {
+    if(scope == "none")
+      scope_ = NONE;
+    else if(scope == "request")
+      scope_ = REQUEST;
+    else if(scope == "worker")
+      scope_ = WORKER;
+    else
+      throw config_exception() << msg_info("Unknown directory cache scope: " + scope);
+  }
+
+  DirectoryCache::Scope DirectoryCache::getScope() {
+    return scope_;
+  }
+
+  size_t DirectoryCache::hits() {
+    return hits_;
+  }
+
+  size_t DirectoryCache::misses() {
+    return misses_;
+  }
+}
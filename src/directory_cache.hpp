@@ -0,0 +1,74 @@
+#ifndef _JANOSH_DIRECTORY_CACHE_HPP
+#define _JANOSH_DIRECTORY_CACHE_HPP
+
+#include <map>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include "value.hpp"
+
+namespace janosh {
+  using std::string;
+  using std::map;
+
+  /**
+   * Caches the descriptors of directory records keyed by their pretty path, so repeated
+   * lookups of the same parents within one request don't hit the backend.
+   * With request scope the cache of a thread is cleared at the start of every request.
+   * With worker scope it lives as long as the worker thread and is shared by all connections the worker
+ * serves. Writes of any thread invalidate it.
+   */
+  class DirectoryCache {
+  public:
+    enum Scope {
+      NONE,
+      REQUEST,
+      WORKER
+    };
+
+  private:
+    std::mutex mutex_;
+    map<string, Value> entries_;
+    //bumped on every invalidation. protects against caching descriptors read before a write.
+    size_t generation_ = 0;
+
+    static Scope scope_;
+    static std::mutex instancesMutex_;
+    static map<std::thread::id, DirectoryCache*> instances_;
+    static std::atomic<size_t> hits_;
+    static std::atomic<size_t> misses_;
+
+    void erase(const string& path);
+    void clear();
+  public:
+    bool get(const string& path, Value& value);
+
+    /**
+     * Returns the generation of the cache. Take it before reading a descriptor from the backend.
+     */
+    size_t generation();
+
+    /**
+     * Caches a descriptor unless the cache was invalidated since the generation was taken.
+     */
+    void put(const string& path, const Value& value, const size_t generation);
+    void beginRequest();
+
+    static DirectoryCache* getInstancePerThread();
+    static void removeInstancePerThread();
+
+    /**
+     * Drops the entry of a directory from the cache of this thread, or from all caches in worker scope.
+     */
+    static void invalidate(const string& path);
+    static void invalidateAll();
+
+    static void setScope(const string& scope);
+    static Scope getScope();
+    static size_t hits();
+    static size_t misses();
+  };
+}
+
+#endif
@@ -0,0 +1,139 @@
+#include <cassert>
+#include "embedded_backend.hpp"
+#include "exception.hpp"
+#include "exithandler.hpp"
+#include "logger.hpp"
+
+namespace janosh {
+  namespace kc = kyotocabinet;
+
+  kc::PolyDB* EmbeddedBackend::pdb_ = NULL;
+  size_t EmbeddedBackend::refs_ = 0;
+  std::mutex EmbeddedBackend::mutex_;
+
+  EmbeddedCursor::EmbeddedCursor(kc::PolyDB::Cursor* cur) : cur_(cur) {
+  }
+
+  EmbeddedCursor::~EmbeddedCursor() {
+    delete cur_;
+  }
+
+  bool EmbeddedCursor::jump() {
+    return cur_->jump();
+  }
+
+  bool EmbeddedCursor::jump(const string& key) {
+    return cur_->jump(key);
+  }
+
+  bool EmbeddedCursor::jump_back(const string& key) {
+    return cur_->jump_back(key);
+  }
+
+  bool EmbeddedCursor::step() {
+    return cur_->step();
+  }
+
+  bool EmbeddedCursor::step_back() {
+    return cur_->step_back();
+  }
+
+  bool EmbeddedCursor::set_value_str(const string& value) {
+    return cur_->set_value_str(value);
+  }
+
+  bool EmbeddedCursor::remove() {
+    return cur_->remove();
+  }
+
+  bool EmbeddedCursor::get_key(string* key, bool step) {
+    return cur_->get_key(key, step);
+  }
+
+  bool EmbeddedCursor::get_value(string* value, bool step) {
+    return cur_->get_value(value, step);
+  }
+
+  bool EmbeddedCursor::get(string* key, string* value, bool step) {
+    return cur_->get(key, value, step);
+  }
+
+  EmbeddedBackend::EmbeddedBackend(const string& dbString) :
+      dbString_(dbString.empty() ? "+" : dbString) {
+  }
+
+  EmbeddedBackend::~EmbeddedBackend() {
+  }
+
+  void EmbeddedBackend::open() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(pdb_ == NULL) {
+      LOG_DEBUG_MSG("Open embedded db", dbString_);
+      kc::PolyDB* pdb = new kc::PolyDB();
+      if(!pdb->open(dbString_, kc::PolyDB::OWRITER | kc::PolyDB::OCREATE)) {
+        string err = pdb->error().name();
+        delete pdb;
+        throw db_exception() << string_info({"Unable to open embedded db", dbString_, err});
+      }
+
+      pdb_ = pdb;
+      ExitHandler::getInstance()->addExitFunc([](){
+        if(pdb_ != NULL)
+          pdb_->close();
+      });
+    }
+    ++refs_;
+  }
+
+  void EmbeddedBackend::close() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    assert(refs_ > 0);
+    --refs_;
+    //keep the db open for the lifetime of the daemon. it's synchronized on exit.
+    pdb_->synchronize();
+  }
+
+  StorageCursor* EmbeddedBackend::cursor() {
+    return new EmbeddedCursor(pdb_->cursor());
+  }
+
+  bool EmbeddedBackend::set(const string& key, const string& value) {
+    return pdb_->set(key, value);
+  }
+
+  bool EmbeddedBackend::add(const string& key, const string& value) {
+    return pdb_->add(key, value);
+  }
+
+  bool EmbeddedBackend::replace(const string& key, const string& value) {
+    return pdb_->replace(key, value);
+  }
+
+  bool EmbeddedBackend::remove(const string& key) {
+    return pdb_->remove(key);
+  }
+
+  bool EmbeddedBackend::get(const string& key, string* value) {
+    return pdb_->get(key, value);
+  }
+
+  bool EmbeddedBackend::clear() {
+    return pdb_->clear();
+  }
+
+  int64_t EmbeddedBackend::set_bulk(const std::map<string, string>& recs) {
+    return pdb_->set_bulk(recs, false);
+  }
+
+  int64_t EmbeddedBackend::remove_bulk(const std::vector<string>& keys) {
+    return pdb_->remove_bulk(keys, false);
+  }
+
+  int64_t EmbeddedBackend::get_bulk(const std::vector<string>& keys, std::map<string, string>* recs) {
+    return pdb_->get_bulk(keys, recs, false);
+  }
+
+  int64_t EmbeddedBackend::match_prefix(const string& prefix, std::vector<string>* keys) {
+    return pdb_->match_prefix(prefix, keys);
+  }
+}
@@ -0,0 +1,61 @@
+#ifndef _JANOSH_EMBEDDED_BACKEND_HPP
+#define _JANOSH_EMBEDDED_BACKEND_HPP
+
+#include <mutex>
+#include <kcpolydb.h>
+#include "storage_backend.hpp"
+
+namespace janosh {
+
+  class EmbeddedCursor : public StorageCursor {
+    kyotocabinet::PolyDB::Cursor* cur_;
+  public:
+    explicit EmbeddedCursor(kyotocabinet::PolyDB::Cursor* cur);
+    virtual ~EmbeddedCursor();
+
+    virtual bool jump() override;
+    virtual bool jump(const string& key) override;
+    virtual bool jump_back(const string& key) override;
+    virtual bool step() override;
+    virtual bool step_back() override;
+    virtual bool set_value_str(const string& value) override;
+    virtual bool remove() override;
+    virtual bool get_key(string* key, bool step = false) override;
+    virtual bool get_value(string* value, bool step = false) override;
+    virtual bool get(string* key, string* value, bool step = false) override;
+  };
+
+  /**
+   * Runs a kyotocabinet database inside the daemon. All instances share
+   * one process wide PolyDB which is opened on first use and closed on exit.
+   * The embeddedDb setting names an ordered database (e.g. "janosh-embedded.kct" or "+").
+   * It is kept apart from the dbstring ktserver opens.
+   */
+  class EmbeddedBackend : public StorageBackend {
+    static kyotocabinet::PolyDB* pdb_;
+    static size_t refs_;
+    static std::mutex mutex_;
+    string dbString_;
+  public:
+    explicit EmbeddedBackend(const string& dbString);
+    virtual ~EmbeddedBackend();
+
+    virtual void open() override;
+    virtual void close() override;
+    virtual StorageCursor* cursor() override;
+
+    virtual bool set(const string& key, const string& value) override;
+    virtual bool add(const string& key, const string& value) override;
+    virtual bool replace(const string& key, const string& value) override;
+    virtual bool remove(const string& key) override;
+    virtual bool get(const string& key, string* value) override;
+    virtual bool clear() override;
+
+    virtual int64_t set_bulk(const std::map<string, string>& recs) override;
+    virtual int64_t remove_bulk(const std::vector<string>& keys) override;
+    virtual int64_t get_bulk(const std::vector<string>& keys, std::map<string, string>* recs) override;
+    virtual int64_t match_prefix(const string& prefix, std::vector<string>* keys) override;
+  };
+}
+
+#endif
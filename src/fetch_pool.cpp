@@ -0,0 +1,51 @@
+#include "fetch_pool.hpp"
+#include "record.hpp"
+#include "directory_cache.hpp"
+#include "logger.hpp"
+#include <chrono>
+
+namespace janosh {
+  FetchPool* FetchPool::instance_ = NULL;
+  std::mutex FetchPool::instanceMutex_;
+
+  FetchPool::FetchPool(Settings& settings, const size_t numThreads) {
+    for(size_t i = 0; i < numThreads; ++i) {
+      workers_.push_back(std::thread([this, &settings](){
+        Logger::registerThread("Fetch");
+        this->workerLoop(settings);
+      }));
+    }
+  }
+
+  void FetchPool::workerLoop(Settings& settings) {
+    //tasks run anyway and fail if the backend is missing
+    Record::checkDB(settings);
+    std::chrono::steady_clock::time_point lastUse = std::chrono::steady_clock::now();
+
+    while(true) {
+      Task task = tasks_.pop();
+      if(!Record::hasDB() || (settings.healthCheckInterval > 0
+          && std::chrono::steady_clock::now() - lastUse >= std::chrono::milliseconds(settings.healthCheckInterval)))
+        Record::checkDB(settings);
+
+      //in request scope the cache of this thread must not outlive a task
+      DirectoryCache::getInstancePerThread()->beginRequest();
+      (*task)();
+      lastUse = std::chrono::steady_clock::now();
+    }
+  }
+
+  std::future<void> FetchPool::submit(std::function<void()> task) {
+    Task t = std::make_shared<std::packaged_task<void()>>(task);
+    std::future<void> result = t->get_future();
+    tasks_.push(t);
+    return result;
+  }
+
+  FetchPool* FetchPool::getInstance(Settings& settings) {
+    std::unique_lock<std::mutex> lock(instanceMutex_);
+    if(instance_ == NULL && settings.fetchThreads > 0)
+      instance_ = new FetchPool(settings, settings.fetchThreads);
+    return instance_;
+  }
+}
@@ -0,0 +1,45 @@
+#ifndef _JANOSH_FETCH_POOL_HPP
+#define _JANOSH_FETCH_POOL_HPP
+
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <future>
+#include <functional>
+#include "settings.hpp"
+#include "queue.hpp"
+
+namespace janosh {
+
+  /**
+   * A daemon wide pool of threads that read records on behalf of requests.
+   * Every thread owns a backend connection, so independent reads of one request run concurrently.
+   * Records are bound to the backend of the thread that created them and must be recreated inside a task.
+   */
+  class FetchPool {
+    typedef std::shared_ptr<std::packaged_task<void()>> Task;
+
+    Queue<Task> tasks_;
+    std::vector<std::thread> workers_;
+
+    static FetchPool* instance_;
+    static std::mutex instanceMutex_;
+
+    FetchPool(Settings& settings, const size_t numThreads);
+    void workerLoop(Settings& settings);
+  public:
+    /**
+     * Queues a task.
+     * @return a future that becomes ready when the task has run and rethrows its exception.
+     */
+    std::future<void> submit(std::function<void()> task);
+
+    /**
+     * @return the pool or NULL if fetchThreads is 0.
+     */
+    static FetchPool* getInstance(Settings& settings);
+  };
+}
+
+#endif
@@ -0,0 +1,363 @@
+#include <boost/format.hpp>
+#include "importer.hpp"
+#include "janosh.hpp"
+#include "exception.hpp"
+#include "tracker.hpp"
+#include "logger.hpp"
+#include "directory_cache.hpp"
+
+namespace janosh {
+
+  Importer::Importer(Janosh* janosh, Record target, const size_t numWorkers) :
+      janosh_(janosh),
+      target_(target),
+      numWorkers_(numWorkers > 0 ? numWorkers : 1),
+      inflight_(numWorkers_ * 2),
+      cnt_(0),
+      depth_(0),
+      members_(0),
+      rootType_(Value::Null) {
+  }
+
+  Importer::~Importer() {
+    join();
+  }
+
+  size_t Importer::import(std::istream& is) {
+    target_.fetch();
+    if(!target_.isDirectory())
+      throw janosh_exception() << record_info({"import target has to be a directory", target_});
+
+    if(!target_.path().isRoot() && target_.exists())
+      throw janosh_exception() << record_info({"import target exists", target_});
+
+    bool publish = Tracker::getInstancePerThread()->getDoPublish();
+    for(size_t i = 0; i < numWorkers_; ++i) {
+      Queue<ImportJob>* queue = new Queue<ImportJob>();
+      queues_.push_back(queue);
+      Settings& settings = janosh_->settings_;
+      workers_.push_back(std::thread([=,&settings](){
+        Logger::registerThread("Importer");
+        this->workerLoop(settings, queue, publish);
+        Logger::removeThread();
+      }));
+    }
+
+    try {
+      jsoncons::json_reader reader(is, *this);
+      reader.read();
+    } catch(...) {
+      join();
+      rollback();
+      throw;
+    }
+    join();
+
+    if(!errors_.empty()) {
+      rollback();
+      throw db_exception() << string_info(errors_);
+    }
+
+    if(target_.path().isRoot()) {
+      char t = (rootType_ == Value::Array ? 'A' : 'O');
+      const string& root = (boost::format("%c%d") % t % members_).str();
+      Tracker::getInstancePerThread()->update(target_.path().pretty(), root, Tracker::WRITE);
+      if(!Record::getDB()->set(target_.path(), root))
+        throw db_exception() << record_info({"failed to write root", target_});
+      Tracker::getInstancePerThread()->settle(target_.path().pretty(), root, Tracker::WRITE);
+    } else {
+      Record dir = RecordPool::get(target_.path());
+      dir.fetch();
+      janosh_->setContainerSize(dir, members_);
+    }
+
+    return cnt_ + 1;
+  }
+
+  void Importer::join() {
+    for(Queue<ImportJob>* queue : queues_)
+      queue->push(ImportJob());
+
+    for(std::thread& t : workers_)
+      t.join();
+
+    for(Queue<ImportJob>* queue : queues_)
+      delete queue;
+
+    workers_.clear();
+    queues_.clear();
+  }
+
+  /**
+   * Removes what a failed import has written into a directory target. The sizes of partially
+   * written directories can't be trusted, so the records are found by the key prefix of the target.
+   * An import into the root can't be told apart from the existing records and is left as it is.
+   */
+  void Importer::rollback() {
+    if(target_.path().isRoot())
+      return;
+
+    try {
+      Record target = RecordPool::get(target_.path());
+      if(!target.fetch().exists())
+        return;
+
+      const string& prefix = target_.path().basePath().key() + "/";
+      const string& dir = target_.path().key();
+      std::vector<string> keys;
+      janosh::Cursor* cur = Record::getDB()->cursor();
+      string key;
+      cur->jump(prefix);
+      while(cur->get_key(&key, true) && key.compare(0, prefix.size(), prefix) == 0) {
+        if(key != dir)
+          keys.push_back(key);
+      }
+      delete cur;
+
+      BulkWriter writer(Record::getDB(), janosh_->settings_.bulkBatchSize);
+      for(const string& k : keys) {
+        Tracker::getInstancePerThread()->update(Path(k).pretty(), "", Tracker::DELETE);
+        writer.remove(k);
+      }
+      writer.flush();
+
+      //the directory itself is empty now and removed like any other
+      janosh_->remove(target);
+    } catch(std::exception& ex) {
+      LOG_ERR_MSG("Unable to roll back the import", ex.what());
+    }
+  }
+
+  void Importer::workerLoop(Settings& settings, Queue<ImportJob>* queue, bool publish) {
+    ImportJob job;
+    bool failed = false;
+    Tracker::setDoPublish(publish);
+    try {
+      Record::makeDB(settings);
+    } catch(std::exception& ex) {
+      std::unique_lock<std::mutex> lock(errorMutex_);
+      errors_.push_back(ex.what());
+      failed = true;
+    }
+    bool open = !failed;
+
+    while(true) {
+      queue->pop(job);
+      if(!job.value)
+        break;
+
+      //keep draining the queue after a failure so the parser doesn't block
+      if(!failed) {
+        try {
+          BulkWriter writer(Record::getDB(), settings.bulkBatchSize);
+          write(*job.value, job.path, writer);
+          writer.flush();
+        } catch(std::exception& ex) {
+          std::unique_lock<std::mutex> lock(errorMutex_);
+          errors_.push_back(ex.what());
+          failed = true;
+        }
+      }
+      job.value.reset();
+      inflight_.notify();
+    }
+
+    DirectoryCache::removeInstancePerThread();
+    if(open)
+      Record::destroyDB();
+    else
+      Tracker::removeInstancePerThread();
+  }
+
+  bool Importer::write(const jsoncons::json& value, Path& path, BulkWriter& writer) {
+    string v;
+    Value::Type t;
+
+    if(value.is_object() || value.is_array()) {
+      size_t size = 0;
+      if(value.is_object()) {
+        for(const auto& member : value.object_range()) {
+          path.pushMember(string(member.key().data(), member.key().length()));
+          if(write(member.value(), path, writer))
+            ++size;
+          path.pop();
+        }
+      } else {
+        for(const auto& element : value.array_range()) {
+          path.pushIndex(size);
+          if(write(element, path, writer))
+            ++size;
+          path.pop();
+        }
+      }
+
+      path.pushMember(".");
+      const string& dir = (boost::format("%c%d") % (value.is_array() ? 'A' : 'O') % size).str();
+      Tracker::getInstancePerThread()->update(path.pretty(), dir, Tracker::WRITE);
+      writer.set(path, dir);
+      path.pop();
+      ++cnt_;
+      return true;
+    } else if(value.is_string()) {
+      v = value.as_string();
+      t = Value::String;
+    } else if(value.is_integer()) {
+      v = std::to_string(value.as_integer());
+      t = Value::Number;
+    } else if(value.is_uinteger()) {
+      v = std::to_string(value.as_uinteger());
+      t = Value::Number;
+    } else if(value.is_double()) {
+      v = std::to_string(value.as_double());
+      t = Value::Number;
+    } else if(value.is_bool()) {
+      v = std::to_string(value.as_bool());
+      t = Value::Boolean;
+    } else {
+      //there is no record for null. it still counts towards the size of its container and takes up its index.
+      return true;
+    }
+
+    const Value val(v, t);
+    Tracker::getInstancePerThread()->update(path.pretty(), val.makeDBString(), Tracker::WRITE);
+    writer.set(path, val.makeDBString());
+    ++cnt_;
+    return true;
+  }
+
+  void Importer::dispatch(std::shared_ptr<jsoncons::json> value) {
+    ImportJob job;
+    job.value = value;
+    job.path = target_.path().basePath();
+    if(rootType_ == Value::Array)
+      job.path.pushIndex(members_);
+    else
+      job.path.pushMember(name_);
+
+    inflight_.wait();
+    queues_[members_ % numWorkers_]->push(job);
+    ++members_;
+  }
+
+  void Importer::beginContainer(const Value::Type& type) {
+    if(depth_ == 0) {
+      rootType_ = type;
+      if(!target_.path().isRoot())
+        janosh_->makeDirectory(RecordPool::get(target_.path()), type, 0);
+    } else {
+      beginValue();
+    }
+    ++depth_;
+  }
+
+  void Importer::endContainer() {
+    --depth_;
+    if(depth_ > 0)
+      endValue();
+  }
+
+  void Importer::beginValue() {
+    if(depth_ == 1)
+      decoder_.begin_document();
+  }
+
+  void Importer::endValue() {
+    if(depth_ == 1) {
+      decoder_.end_document();
+      dispatch(std::make_shared<jsoncons::json>(decoder_.get_result()));
+    }
+  }
+
+  void Importer::do_begin_document() {
+  }
+
+  void Importer::do_end_document() {
+  }
+
+  void Importer::do_begin_object(const jsoncons::serializing_context& context) {
+    beginContainer(Value::Object);
+    if(depth_ > 1)
+      decoder_.begin_object(context);
+  }
+
+  void Importer::do_end_object(const jsoncons::serializing_context& context) {
+    if(depth_ > 1)
+      decoder_.end_object(context);
+    endContainer();
+  }
+
+  void Importer::do_begin_array(const jsoncons::serializing_context& context) {
+    beginContainer(Value::Array);
+    if(depth_ > 1)
+      decoder_.begin_array(context);
+  }
+
+  void Importer::do_end_array(const jsoncons::serializing_context& context) {
+    if(depth_ > 1)
+      decoder_.end_array(context);
+    endContainer();
+  }
+
+  void Importer::do_name(const string_view_type& name, const jsoncons::serializing_context& context) {
+    if(depth_ == 1)
+      name_.assign(name.data(), name.length());
+    else
+      decoder_.name(name, context);
+  }
+
+  void Importer::do_null_value(const jsoncons::serializing_context& context) {
+    if(depth_ == 0)
+      throw janosh_exception() << msg_info("the document root has to be an object or an array");
+    beginValue();
+    decoder_.null_value(context);
+    endValue();
+  }
+
+  void Importer::do_string_value(const string_view_type& value, const jsoncons::serializing_context& context) {
+    if(depth_ == 0)
+      throw janosh_exception() << msg_info("the document root has to be an object or an array");
+    beginValue();
+    decoder_.string_value(value, context);
+    endValue();
+  }
+
+  void Importer::do_byte_string_value(const uint8_t* data, size_t length, const jsoncons::serializing_context& context) {
+    throw janosh_exception() << msg_info("byte strings are not supported");
+  }
+
+  void Importer::do_bignum_value(int signum, const uint8_t* data, size_t length, const jsoncons::serializing_context& context) {
+    throw janosh_exception() << msg_info("number out of range");
+  }
+
+  void Importer::do_double_value(double value, const jsoncons::floating_point_options& fmt, const jsoncons::serializing_context& context) {
+    if(depth_ == 0)
+      throw janosh_exception() << msg_info("the document root has to be an object or an array");
+    beginValue();
+    decoder_.double_value(value, fmt, context);
+    endValue();
+  }
+
+  void Importer::do_integer_value(int64_t value, const jsoncons::serializing_context& context) {
+    if(depth_ == 0)
+      throw janosh_exception() << msg_info("the document root has to be an object or an array");
+    beginValue();
+    decoder_.integer_value(value, context);
+    endValue();
+  }
+
+  void Importer::do_uinteger_value(uint64_t value, const jsoncons::serializing_context& context) {
+    if(depth_ == 0)
+      throw janosh_exception() << msg_info("the document root has to be an object or an array");
+    beginValue();
+    decoder_.uinteger_value(value, context);
+    endValue();
+  }
+
+  void Importer::do_bool_value(bool value, const jsoncons::serializing_context& context) {
+    if(depth_ == 0)
+      throw janosh_exception() << msg_info("the document root has to be an object or an array");
+    beginValue();
+    decoder_.bool_value(value, context);
+    endValue();
+  }
+}
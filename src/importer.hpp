@@ -0,0 +1,93 @@
+#ifndef _JANOSH_IMPORTER_HPP
+#define _JANOSH_IMPORTER_HPP
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <jsoncons/json.hpp>
+#include "record.hpp"
+#include "settings.hpp"
+#include "semaphore.hpp"
+#include "queue.hpp"
+#include "bulk_writer.hpp"
+
+namespace janosh {
+  using std::string;
+
+  class Janosh;
+
+  /**
+   * A top level member of the imported document together with the path it is written to.
+   * A job without a value tells the worker to stop.
+   */
+  struct ImportJob {
+    Path path;
+    std::shared_ptr<jsoncons::json> value;
+  };
+
+  /**
+   * Imports a json document by distributing its top level members round robin over a number
+   * of worker threads. Every worker has its own backend connection and writes disjoint subtrees.
+   * The size of the target directory is fixed up after all workers have finished.
+   */
+  class Importer : public jsoncons::json_content_handler {
+    Janosh* janosh_;
+    Record target_;
+    size_t numWorkers_;
+    std::vector<Queue<ImportJob>*> queues_;
+    std::vector<std::thread> workers_;
+    //limits the number of parsed members waiting to be written
+    Semaphore inflight_;
+    std::mutex errorMutex_;
+    std::vector<string> errors_;
+    std::atomic<size_t> cnt_;
+
+    jsoncons::json_decoder<jsoncons::json> decoder_;
+    size_t depth_;
+    size_t members_;
+    string name_;
+    Value::Type rootType_;
+
+    void beginContainer(const Value::Type& type);
+    void endContainer();
+    void beginValue();
+    void endValue();
+    void dispatch(std::shared_ptr<jsoncons::json> value);
+    void join();
+    void rollback();
+    void workerLoop(Settings& settings, Queue<ImportJob>* queue, bool publish);
+    bool write(const jsoncons::json& value, Path& path, BulkWriter& writer);
+
+    void do_begin_document() override;
+    void do_end_document() override;
+    void do_begin_object(const jsoncons::serializing_context& context) override;
+    void do_end_object(const jsoncons::serializing_context& context) override;
+    void do_begin_array(const jsoncons::serializing_context& context) override;
+    void do_end_array(const jsoncons::serializing_context& context) override;
+    void do_name(const string_view_type& name, const jsoncons::serializing_context& context) override;
+    void do_null_value(const jsoncons::serializing_context& context) override;
+    void do_string_value(const string_view_type& value, const jsoncons::serializing_context& context) override;
+    void do_byte_string_value(const uint8_t* data, size_t length, const jsoncons::serializing_context& context) override;
+    void do_bignum_value(int signum, const uint8_t* data, size_t length, const jsoncons::serializing_context& context) override;
+    void do_double_value(double value, const jsoncons::floating_point_options& fmt, const jsoncons::serializing_context& context) override;
+    void do_integer_value(int64_t value, const jsoncons::serializing_context& context) override;
+    void do_uinteger_value(uint64_t value, const jsoncons::serializing_context& context) override;
+    void do_bool_value(bool value, const jsoncons::serializing_context& context) override;
+
+  public:
+    Importer(Janosh* janosh, Record target, const size_t numWorkers);
+    virtual ~Importer();
+
+    /**
+     * Parses the stream and imports it into the target directory.
+     * @param is the input stream
+     * @return number of records written
+     */
+    size_t import(std::istream& is);
+  };
+}
+
+#endif
@@ -13,8 +13,21 @@
 #include "exithandler.hpp"
 #include "lua_script.hpp"
 #include "message_queue.hpp"
+#include "json_loader.hpp"
+#include "importer.hpp"
+#include "scan_iterator.hpp"
+#include "directory_cache.hpp"
+#include "value_cache.hpp"
+#include "member_index.hpp"
+#include "bulk_writer.hpp"
+#include "jsonpath.hpp"
+#include "jsonpath_cache.hpp"
+#include "secondary_index.hpp"
+#include "sparse_array.hpp"
+#include "fetch_pool.hpp"
 
 #include <stack>
+#include <algorithm>
 #include <thread>
 #include <chrono>
 #include <random>
@@ -23,6 +36,7 @@
 #include <boost/tokenizer.hpp>
 #include <boost/token_functions.hpp>
 #include <boost/format.hpp>
+#include <boost/algorithm/string.hpp>
 #include <boost/bind.hpp>
 #include "json_spirit/json_spirit.h"
 #include "jsoncons/json.hpp"
@@ -74,6 +88,10 @@ namespace janosh {
     Tracker::getInstancePerThread()->update(str, value, op);
   }
 
+  void settleOperation(const string& str, const string& value, const Tracker::Operation& op) {
+    Tracker::getInstancePerThread()->settle(str, value, op);
+  }
+
   void Janosh::setFormat(Format f) {
     this->format = f;
   }
@@ -128,14 +146,18 @@ namespace janosh {
   }
 
   size_t Janosh::patch(std::istream& is) {
-    js::Value rootValue;
-    js::read(is, rootValue);
-
-    Path path;
-    return patch(rootValue, path);
+    JsonLoader loader(this, JsonLoader::PATCH);
+    return loader.load(is);
   }
 
   size_t Janosh::filter(vector<Record> recs, const std::string& jsonPathExpr, std::ostream& out) {
+    JsonPathPtr jsonPath = JsonPathCache::get(jsonPathExpr);
+    if(jsonPath->isNative() && recs.size() == 1) {
+      return select(recs.front(), *jsonPath, [&](const json& match) {
+        out << match.as<std::string>() << '\n';
+      });
+    }
+
     JsonPathVisitor* vis = new JsonPathVisitor(out);
     this->get(recs, vis, out);
 
@@ -148,31 +170,80 @@ namespace janosh {
     return result.size();
   }
 
-  size_t Janosh::get(vector<Record> recs, std::ostream& out) {
-    PrintVisitor* vis = NULL;
+  size_t Janosh::get(vector<Record> recs, std::ostream& out, const GetOptions& options) {
+    PrintVisitor* vis = makeVisitor(out);
+    //selective gets read only parts of their directories, there is nothing to read ahead
+    FetchPool* pool = recs.size() > 1 && !options.isSelective(true) ? FetchPool::getInstance(settings_) : NULL;
+    size_t c = this->get(recs, vis, out, options, pool);
+    delete vis;
+
+    return c;
+  }
+
+  /**
+   * Creates a print visitor for the current output format.
+   * @param out the stream the visitor prints to.
+   * @return the visitor. owned by the caller.
+   */
+  PrintVisitor* Janosh::makeVisitor(std::ostream& out) {
     switch (this->getFormat()) {
-    case Json:
-      vis = new JsonPrintVisitor(out);
-      break;
     case Bash:
-      vis = new BashPrintVisitor(out);
-      break;
+      return new BashPrintVisitor(out);
     case Raw:
-      vis = new RawPrintVisitor(out);
-      break;
+      return new RawPrintVisitor(out);
+    case Json:
+    default:
+      return new JsonPrintVisitor(out);
     }
-    size_t c = this->get(recs, vis, out);
-    delete vis;
+  }
 
-    return c;
+  typedef vector<std::pair<string, string>> Prefetched;
+
+  /**
+   * Reads the records below the requested directories with the threads of the fetch pool.
+   * The records are only read. Printing them and tracking the reads is left to the calling thread.
+   * @param recs the requested records. Requested values aren't read ahead.
+   * @param pool the fetch pool.
+   * @param chunkSize the number of records per bulk read.
+   * @param prefetched receives the records below each requested directory, in key order.
+   * @return a future per requested record that rethrows the error of its read. Invalid for values.
+   */
+  static vector<std::future<void>> prefetch(const vector<Record>& recs, FetchPool* pool, const size_t chunkSize, vector<std::shared_ptr<Prefetched>>& prefetched) {
+    vector<std::future<void>> results;
+    for (const Record& rec : recs) {
+      std::shared_ptr<Prefetched> records = std::make_shared<Prefetched>();
+      prefetched.push_back(records);
+      if(!rec.path().isDirectory()) {
+        results.push_back(std::future<void>());
+        continue;
+      }
+
+      const string prefix = rec.path().basePath().key() + "/";
+      const string start = rec.path().key();
+      //records are bound to the backend of the thread that created them, so the pool thread scans with its own
+      results.push_back(pool->submit([records, prefix, start, chunkSize]() {
+        ScanIterator scan(Record::getDB(), prefix, start, chunkSize);
+        string key, value;
+        while(scan.next(key, value))
+          records->push_back({key, value});
+      }));
+    }
+    return results;
   }
+
   /**
    * Recursively traverses a record and prints it out.
    * @param rec The record to print out.
    * @param out The output stream to write to.
+   * @param pool if set, the directories are read ahead by the fetch pool while the records before them are printed.
    * @return number of total records affected.
    */
-  size_t Janosh::get(vector<Record> recs, PrintVisitor* vis,std::ostream& out) {
+  size_t Janosh::get(vector<Record> recs, PrintVisitor* vis,std::ostream& out, const GetOptions& options, FetchPool* pool) {
+    vector<std::shared_ptr<Prefetched>> prefetched;
+    vector<std::future<void>> results;
+    if(pool != NULL)
+      results = prefetch(recs, pool, settings_.scanChunkSize, prefetched);
+
     vis->begin();
 
     size_t cnt = 1;
@@ -181,9 +252,10 @@ namespace janosh {
       out << "{" << '\n';
 
     bool first = true;
-    for (Record& rec : recs) {
+    for (size_t i = 0; i < recs.size(); ++i) {
+      Record& rec = recs[i];
       JANOSH_TRACE( { rec });
-      rec.fetch();
+      rec.lookup();
 
       LOG_DEBUG_MSG("get", rec.path().pretty());
 
@@ -194,7 +266,21 @@ namespace janosh {
       if(recs.size() > 1 && this->getFormat() == Json && !first)
         out << "," << '\n';
 
-      if (rec.isDirectory()) {
+      if (rec.isDirectory() && options.isSelective(rec.isArray())) {
+        recurseSelection(rec, options, vis, (recs.size() > 1 ? Value::Object : Value::Array));
+      } else if (rec.isDirectory() && pool != NULL) {
+        results[i].get();
+        Prefetched::const_iterator it = prefetched[i]->begin();
+        Prefetched::const_iterator end = prefetched[i]->end();
+        render(rec.path(), [&](string& key, string& value) {
+          if(it == end)
+            return false;
+          key = (*it).first;
+          value = (*it).second;
+          ++it;
+          return true;
+        }, vis, (recs.size() > 1 ? Value::Object : Value::Array));
+      } else if (rec.isDirectory()) {
         recurseDirectory(rec, vis, (recs.size() > 1 ? Value::Object : Value::Array), out);
       } else {
         recurseValue(rec, vis, (recs.size() > 1 ? Value::Object : Value::Array), out);
@@ -219,14 +305,32 @@ namespace janosh {
 
   size_t Janosh::random(Record rec, const string& jsonPathExpr, std::ostream& out) {
     std::mt19937 mt(rd());
+    JsonPathPtr jsonPath = JsonPathCache::get(jsonPathExpr);
+    if(jsonPath->isNative()) {
+      vector<json> matches;
+      select(rec, *jsonPath, [&](const json& match) {
+        matches.push_back(match);
+      });
+
+      if(matches.empty())
+        return 0;
+
+      std::uniform_int_distribution<size_t> dist(0, matches.size() - 1);
+      out << matches[dist(mt)].as<std::string>() << '\n';
+      return matches.size();
+    }
+
     JsonPathVisitor* vis = new JsonPathVisitor(out);
     this->get({rec}, vis, out);
 
     json result = jsonpath::json_query(*vis->getRoot(), jsonPathExpr);
-    std::uniform_int_distribution<size_t> dist(0, result.size() - 1);
+    delete vis;
 
+    if(result.size() == 0)
+      return 0;
+
+    std::uniform_int_distribution<size_t> dist(0, result.size() - 1);
     out << result[dist(mt)].as<std::string>() << '\n';
-    delete vis;
 
     return result.size();
   }
@@ -241,29 +345,28 @@ namespace janosh {
     std::mt19937 mt(rd());
     Path parent = rec.path();
 
+    if(rec.getSize() == 0)
+      throw janosh_exception() << record_info( { "Directory is empty", rec });
+
     if(rec.isObject()) {
-      std::uniform_int_distribution<size_t> dist(1, rec.getSize());
-      size_t pick = dist(mt);
-
-      for(size_t i = 0; i < pick; ++i) {
-        rec.step();
-        if (rec.path().parent() != parent) {
-          do {
-            rec.step();
-          } while (rec.path().parent() != parent);
-        }
-      }
-      return this->get({rec}, out);
+      std::uniform_int_distribution<size_t> dist(0, rec.getSize() - 1);
+      string key;
+      if(!MemberIndex::member(parent, rec.getSize(), dist(mt), key))
+        throw janosh_exception() << record_info( { "Member not found", rec });
+
+      return this->get({RecordPool::get(key)}, out);
     } else {
       std::uniform_int_distribution<size_t> dist(0, rec.getSize() - 1);
-        Path p = rec.path();
-        p.pop(false);
-        p.pushIndex(dist(mt));
+        Path p;
+        if(!element(rec.path(), dist(mt), p))
+          throw janosh_exception() << record_info( { "Element not found", rec });
         Record r = RecordPool::get(p);
         r.fetch();
 
-        if(!r.exists())
+        if(!r.exists()) {
           p.pushMember(".");
+          r = RecordPool::get(p);
+        }
         return this->get({r}, out);
     }
   }
@@ -275,13 +378,18 @@ namespace janosh {
     parents.push_back(travRoot);
 
     std::stack<std::pair<const Component, const Value::Type> > hierachy;
+    const bool sparse = SparseArray::enabled();
     size_t cnt = 0;
     Path last;
+    Path logicalPath;
     Record* rec;
     for (size_t i = 0; i < parents.size(); ++i) {
       rec = &parents[i];
-      rec->fetch();
+      rec->lookup();
       const Path& path = rec->path();
+      if(sparse)
+        logicalPath = logical(path);
+      const Path& shown = sparse ? logicalPath : path;
       const Value& value = rec->value();
       const Value::Type& t = rec->getType();
       const Path& parent = path.parent();
@@ -293,9 +401,9 @@ namespace janosh {
         if (!last.above(path) && ((!last.isDirectory() && parentName != last.parentName()) || (last.isDirectory() && parentName != last.name()))) {
           while (!hierachy.empty() && hierachy.top().first != parentName) {
             if (hierachy.top().second == Value::Array) {
-              vis->endArray(path);
+              vis->endArray(shown);
             } else if (hierachy.top().second == Value::Object) {
-              vis->endObject(path);
+              vis->endObject(shown);
             }
             hierachy.pop();
           }
@@ -310,7 +418,7 @@ namespace janosh {
           parentType = hierachy.top().second;
 
         hierachy.push( { name, Value::Array });
-        vis->beginArray(path, parentType == Value::Array, last.isEmpty() || last == parent);
+        vis->beginArray(shown, parentType == Value::Array, last.isEmpty() || last == parent);
       } else if (t == Value::Object) {
         Value::Type parentType;
         if (hierachy.empty())
@@ -320,14 +428,14 @@ namespace janosh {
 
         if(!name.pretty().empty()) {
           hierachy.push( { name, Value::Object });
-          vis->beginObject(path, parentType == Value::Array, last.isEmpty() || last == parent);
+          vis->beginObject(shown, parentType == Value::Array, last.isEmpty() || last == parent);
         }
       } else {
         bool first = last.isEmpty() || last == parent;
         if (!hierachy.empty()) {
-          vis->record(path, value, hierachy.top().second == Value::Array, first);
+          vis->record(shown, value, hierachy.top().second == Value::Array, first);
         } else {
-          vis->record(path, value, false, first);
+          vis->record(shown, value, false, first);
         }
       }
       last = path;
@@ -350,16 +458,220 @@ namespace janosh {
   size_t Janosh::recurseDirectory(Record& dir, PrintVisitor* vis, Value::Type rootType, ostream& out) {
     JANOSH_TRACE( { dir });
 
+    Path travRoot = dir.path();
+    ScanIterator scan(Record::getDB(), travRoot.basePath().key() + "/", travRoot.key(), settings_.scanChunkSize);
+    return render(travRoot, [&](string& key, string& value) {
+      return scan.next(key, value);
+    }, vis, rootType);
+  }
+
+  /**
+   * A read of a selective get. Either a single directory descriptor with its value
+   * or a range that covers a record and everything below it.
+   */
+  struct SelectionRead {
+    string key;
+    string value;
+    bool range;
+  };
+
+  /**
+   * Sorts projected fields so that fields sharing a parent are read together
+   * and drops fields that are already covered by a field above them.
+   * Fields are compared component by component, as plain strings "a-b" would sort between "a" and "a/x".
+   */
+  static vector<string> normalizeFields(const vector<string>& fields) {
+    vector<std::pair<vector<string>, string>> sorted;
+    for(const string& f : fields) {
+      vector<string> keys;
+      boost::split(keys, f, boost::is_any_of("/"));
+      for(string& k : keys)
+        k = Component(k).key();
+      sorted.push_back({keys, f});
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    vector<string> normalized;
+    const vector<string>* last = NULL;
+    for(const auto& s : sorted) {
+      if(last != NULL && s.first.size() >= last->size() && std::equal(last->begin(), last->end(), s.first.begin()))
+        continue;
+      normalized.push_back(s.second);
+      last = &s.first;
+    }
+    return normalized;
+  }
+
+  /**
+   * Looks up the child a component of a projected field names. Indices below sparse arrays name the n-th element.
+   * @param dir the directory the component is relative to.
+   * @param descriptor the value of the directory record.
+   * @param name the component.
+   * @param child receives the path of the child.
+   * @return false if a sparse array has no such element.
+   */
+  static bool fieldChild(const Path& dir, const string& descriptor, const string& name, Path& child) {
+    Component c(name);
+    if(c.isIndex() && SparseArray::matches(dir)) {
+      const Value array(descriptor, true);
+      if(array.getType() == Value::Array)
+        return SparseArray::element(dir, array.getSize(), lexical_cast<size_t>(c.pretty().substr(1)), child);
+    }
+
+    child = dir.withChild(c);
+    return true;
+  }
+
+  /**
+   * Plans the reads that project a directory to a list of fields.
+   * Intermediate directories of nested fields are read once as descriptors.
+   * @param base the directory to project.
+   * @param descriptor the value of the directory record.
+   * @param fields normalized relative paths below the directory.
+   * @param reads the list the reads are appended to.
+   */
+  static void planProjection(const Path& base, const string& descriptor, const vector<string>& fields, vector<SelectionRead>& reads) {
+    StorageBackend* db = Record::getDB();
+    //the keys and descriptors of the intermediate directories of the last field
+    vector<std::pair<string, string>> open;
+
+    for(const string& field : fields) {
+      vector<string> components;
+      boost::split(components, field, boost::is_any_of("/"));
+      Path p = base;
+      string parent = descriptor;
+      Path child;
+      bool found = true;
+
+      for(size_t i = 0; i + 1 < components.size(); ++i) {
+        if(!fieldChild(p, parent, components[i], child)) {
+          found = false;
+          break;
+        }
+
+        p = child.asDirectory();
+        if(i < open.size() && open[i].first == p.key()) {
+          parent = open[i].second;
+          continue;
+        }
+
+        open.resize(i);
+        if(!db->get(p.key(), &parent)) {
+          found = false;
+          break;
+        }
+        open.push_back({p.key(), parent});
+        reads.push_back({p.key(), parent, false});
+      }
+
+      if(found && fieldChild(p, parent, components.back(), child))
+        reads.push_back({child.key(), "", true});
+    }
+  }
+
+  /**
+   * Prints a page of array elements and/or a projection of objects to a list of fields.
+   * The cursor jumps to the encoded key of every element and field that is selected and
+   * reads only the records below it. Projections of arrays apply to each element.
+   * @param dir the directory record.
+   * @param options the page and the fields to select.
+   * @param vis the print visitor.
+   * @param rootType the type of the enclosing container.
+   * @return number of records printed.
+   */
+  size_t Janosh::recurseSelection(Record& dir, const GetOptions& options, PrintVisitor* vis, Value::Type rootType) {
+    JANOSH_TRACE( { dir });
+
+    const Path travRoot = dir.path();
+    const vector<string> fields = normalizeFields(options.fields);
+    vector<SelectionRead> reads;
+    reads.push_back({travRoot.key(), dir.value().str(), false});
+
+    if(dir.isArray()) {
+      const size_t size = dir.getSize();
+      const size_t begin = std::min(options.offset, size);
+      const size_t end = options.limit > 0 ? std::min(size, begin + options.limit) : size;
+      const bool sparse = SparseArray::matches(travRoot);
+      string descriptor;
+      Path element;
+
+      for(size_t pos = begin; pos < end; ++pos) {
+        //reverse pages count from the last element
+        const size_t n = options.reverse ? size - 1 - pos : pos;
+        if(!sparse)
+          element = travRoot.withChild(n);
+        else if(!SparseArray::element(travRoot, size, n, element))
+          throw db_exception() << record_info({"corrupted array detected", dir});
+
+        if(!fields.empty() && Record::getDB()->get(element.asDirectory().key(), &descriptor)) {
+          reads.push_back({element.asDirectory().key(), descriptor, false});
+          planProjection(element, descriptor, fields, reads);
+        } else {
+          reads.push_back({element.key(), "", true});
+        }
+      }
+    } else {
+      planProjection(travRoot, dir.value().str(), fields, reads);
+    }
+
+    std::unique_ptr<janosh::Cursor> cur(Record::getDB()->cursor());
+    vector<SelectionRead>::const_iterator it = reads.begin();
+    bool inRange = false;
+
+    return render(travRoot, [&](string& key, string& value) {
+      while(true) {
+        if(inRange) {
+          const string& prefix = (it - 1)->key;
+          if(cur->get(&key, &value, true) && (key == prefix || key.compare(0, prefix.size() + 1, prefix + "/") == 0))
+            return true;
+          inRange = false;
+        }
+
+        if(it == reads.end())
+          return false;
+
+        const SelectionRead& read = *it++;
+        if(!read.range) {
+          key = read.key;
+          value = read.value;
+          return true;
+        }
+        inRange = cur->jump(read.key);
+        //the records below a directory follow siblings like "a-b" that sort between "a" and "a/"
+        string first;
+        if(inRange && cur->get_key(&first, false) && first != read.key)
+          inRange = cur->jump(read.key + "/");
+      }
+    }, vis, rootType);
+  }
+
+  /**
+   * Prints records read in key order below a traversal root. The first record has to be the root itself.
+   * @param travRoot the path of the directory that is printed.
+   * @param next fetches the next record. Returns false when there are no more records.
+   * @param vis the print visitor.
+   * @param rootType the type of the enclosing container.
+   * @return number of records printed.
+   */
+  size_t Janosh::render(const Path& travRoot, RecordSource next, PrintVisitor* vis, Value::Type rootType) {
     size_t cnt = 0;
     std::stack<std::pair<const Component, const Value::Type> > hierachy;
-    Path travRoot = dir.path();
     Path last;
-    Record rec(dir);
-    rec.read();
-    do {
-      const Path& path = rec.path();
-      const Value& value = rec.value();
-      const Value::Type& t = rec.getType();
+    Tracker* tracker = Tracker::getInstancePerThread();
+    const bool sparse = SparseArray::enabled();
+    string key;
+    string dbValue;
+    Path logicalPath;
+
+    while(next(key, dbValue)) {
+      const Path path(key);
+      tracker->update(path.pretty(), dbValue, Tracker::READ);
+      //the visitor is shown the logical indices of sparse array elements
+      if(sparse)
+        logicalPath = logical(path);
+      const Path& shown = sparse ? logicalPath : path;
+      const Value& value = Record::makeValue(path, dbValue);
+      const Value::Type& t = (path.isDirectory() ? value.getType() : Value::String);
       const Path& parent = path.parent();
 
       const Component& name = path.name();
@@ -373,9 +685,9 @@ namespace janosh {
         if (!last.above(path) && ((!last.isDirectory() && parentName != last.parentName()) || (last.isDirectory() && parentName != last.name()))) {
           while (!hierachy.empty() && hierachy.top().first != parentName) {
             if (hierachy.top().second == Value::Array) {
-              vis->endArray(path);
+              vis->endArray(shown);
             } else if (hierachy.top().second == Value::Object) {
-              vis->endObject(path);
+              vis->endObject(shown);
             }
             hierachy.pop();
           }
@@ -390,7 +702,7 @@ namespace janosh {
           parentType = hierachy.top().second;
 
         hierachy.push( { name, Value::Array });
-        vis->beginArray(path, parentType == Value::Array, last.isEmpty() || last == parent);
+        vis->beginArray(shown, parentType == Value::Array, last.isEmpty() || last == parent);
       } else if (t == Value::Object) {
         Value::Type parentType;
         if (hierachy.empty())
@@ -399,18 +711,18 @@ namespace janosh {
           parentType = hierachy.top().second;
 
         hierachy.push( { name, Value::Object });
-        vis->beginObject(path, parentType == Value::Array, last.isEmpty() || last == parent);
+        vis->beginObject(shown, parentType == Value::Array, last.isEmpty() || last == parent);
       } else {
         bool first = last.isEmpty() || last == parent;
         if (!hierachy.empty()) {
-          vis->record(path, value, hierachy.top().second == Value::Array, first);
+          vis->record(shown, value, hierachy.top().second == Value::Array, first);
         } else {
-          vis->record(path, value, false, first);
+          vis->record(shown, value, false, first);
         }
       }
       last = path;
       ++cnt;
-    } while (rec.step());
+    }
 
     while (!hierachy.empty()) {
       if (hierachy.top().second == Value::Array) {
@@ -423,29 +735,6 @@ namespace janosh {
 
     return cnt;
   }
-  /**
-   * Creates a temporary record with the given type.
-   * @param t the type of the record to create.
-   * @return the created record
-   */
-  Record Janosh::makeTemp(const Value::Type& t) {
-    JANOSH_TRACE({},t);
-    Record tmp = RecordPool::get("/tmp/.");
-
-    if(!tmp.fetch().exists()) {
-      makeDirectory(tmp, Value::Array, 0);
-      tmp.fetch();
-    }
-
-    if(t == Value::String) {
-      tmp = RecordPool::get(tmp.path().withChild(tmp.getSize()));
-      this->add(tmp, Value("", Value::String));
-    } else {
-      tmp = RecordPool::get(tmp.path().withChild(tmp.getSize()).asDirectory());
-      this->makeDirectory(tmp, t, 0);
-    }
-    return tmp;
-  }
 
   /**
    * Creates an array with given size. Optional performs a bounds check.
@@ -467,8 +756,13 @@ namespace janosh {
       throw janosh_exception() << record_info({"Out of array bounds",target});
     }
     changeContainerSize(target.parent(), 1);
-    announceOperation(target.path().pretty(), "A" + lexical_cast<string>(size), Tracker::WRITE);
-    return Record::getDB()->add(target.path(), "A" + lexical_cast<string>(size)) ? 1 : 0;
+    const string value = "A" + lexical_cast<string>(size);
+    announceOperation(target.path().pretty(), value, Tracker::WRITE);
+    if(!Record::getDB()->add(target.path(), value))
+      return 0;
+
+    settleOperation(target.path().pretty(), value, Tracker::WRITE);
+    return 1;
   }
 
   /**
@@ -493,8 +787,13 @@ namespace janosh {
     if(!target.path().isRoot())
       changeContainerSize(target.parent(), 1);
 
-    announceOperation(target.path().pretty(), "O" + lexical_cast<string>(size), Tracker::WRITE);
-    return Record::getDB()->add(target.path(), "O" + lexical_cast<string>(size)) ? 1 : 0;
+    const string value = "O" + lexical_cast<string>(size);
+    announceOperation(target.path().pretty(), value, Tracker::WRITE);
+    if(!Record::getDB()->add(target.path(), value))
+      return 0;
+
+    settleOperation(target.path().pretty(), value, Tracker::WRITE);
+    return 1;
   }
 
 
@@ -536,6 +835,7 @@ namespace janosh {
 
     announceOperation(dest.path().pretty(), value.makeDBString(), Tracker::WRITE);
     if(Record::getDB()->add(dest.path(), value.makeDBString())) {
+      settleOperation(dest.path().pretty(), value.makeDBString(), Tracker::WRITE);
 //      if(!dest.path().isRoot())
         changeContainerSize(dest.parent(), 1);
       return 1;
@@ -563,7 +863,11 @@ namespace janosh {
     }
 
     announceOperation(dest.path().pretty(),value.makeDBString(), Tracker::WRITE);
-    return Record::getDB()->replace(dest.path(), value.makeDBString());
+    if(!Record::getDB()->replace(dest.path(), value.makeDBString()))
+      return 0;
+
+    settleOperation(dest.path().pretty(), value.makeDBString(), Tracker::WRITE);
+    return 1;
   }
 
 
@@ -615,6 +919,8 @@ namespace janosh {
       } else {
         announceOperation(dest.path().pretty(), src.value().makeDBString(), Tracker::WRITE);
         r = Record::getDB()->replace(dest.path(), src.value().makeDBString());
+        if(r)
+          settleOperation(dest.path().pretty(), src.value().makeDBString(), Tracker::WRITE);
       }
     }
 
@@ -673,6 +979,8 @@ namespace janosh {
       } else {
         announceOperation(dest.path().pretty(), src.value().makeDBString(), Tracker::WRITE);
         r = Record::getDB()->replace(dest.path(), src.value().makeDBString());
+        if(r)
+          settleOperation(dest.path().pretty(), src.value().makeDBString(), Tracker::WRITE);
       }
     }
     remove(src);
@@ -749,39 +1057,10 @@ namespace janosh {
       changeContainerSize(parent, cnt * -1);
     }
 
-    if(pack && parent.isArray()) {
-      parent.read();
-      Record child = RecordPool::get(parent.path()).fetch();
-      size_t left = parent.getSize();
-      child.step();
-      for(size_t i = 0; i < left; ++i) {
-        child.fetch();
-
-        if(child.parent().path() != parent.path()) {
-          throw db_exception() << record_info({"corrupted array detected", parent});
-        }
-        size_t idx = child.getIndex();
-        if(idx > i) {
-          Record indexPos;
-
-          if(child.isDirectory()) {
-            indexPos = RecordPool::get(parent.path().withChild(i).asDirectory());
-            copy(child, indexPos);
-            remove(child, false);
-          } else {
-            indexPos = RecordPool::get(parent.path().withChild(i));
-            copy(child, indexPos);
-            announceOperation(child.path().pretty(),"", Tracker::DELETE);
-            child.remove();
-          }
-        } else {
-          try {
-            child.next();
-          } catch (std::exception& e) {
-          }
-        }
-      }
-      setContainerSize(parent, left);
+    //removing a directory moved target on to the next record, so the index is taken from the path.
+    //sparse arrays keep the gap, the member index skips it when resolving logical indices.
+    if(pack && parent.isArray() && !targetPath.isWildcard() && !SparseArray::matches(parent.path())) {
+      reindex(parent.path(), targetPath.parseIndex() + 1, 0, [](const size_t& i) { return i - 1; });
     }
 
     rec = target;
@@ -801,7 +1080,8 @@ namespace janosh {
       string key,value;
       cur->jump();
 
-      while(cur->get(&key, &value, NULL, true)) {
+      //secondary index entries start with "~" and sort after all records
+      while(cur->get(&key, &value, true) && key.at(0) == '/') {
         out << "path:" << Path(key).pretty() <<  " value:" << value << '\n';
         ++cnt;
       }
@@ -823,7 +1103,7 @@ namespace janosh {
     size_t cnt = 0;
     boost::hash<string> hasher;
     size_t h = 0;
-    while(cur->get(&key, &value, NULL, true)) {
+    while(cur->get(&key, &value, true) && key.at(0) == '/') {
       h = hasher(lexical_cast<string>(h) + key + value);
       ++cnt;
     }
@@ -837,12 +1117,124 @@ namespace janosh {
    * @return 1 on success, 0 on fail
    */
   size_t Janosh::truncate() {
-    if(Record::getDB()->clear())
+    bool cleared = Record::getDB()->clear();
+    //after the clear, values read before it can't be cached anymore
+    invalidateCaches();
+    if(cleared)
       return Record::getDB()->add("/!", "O" + lexical_cast<string>(0)) ? 1 : 0;
     else
       return false;
   }
 
+  /**
+   * Writes records under backend keys as they are. The keys aren't encoded and the sizes
+   * of their containers aren't updated. Meant for repairs and for preparing records
+   * in older encodings, e.g. to try migrate.
+   * @param recs the records by backend key.
+   * @return number of records written.
+   */
+  size_t Janosh::setRaw(const std::map<string, string>& recs) {
+    int64_t cnt = Record::getDB()->set_bulk(recs);
+    //the records bypassed the caches
+    invalidateCaches();
+    if(cnt < 0)
+      throw db_exception() << string_info({"bulk set failed", recs.begin()->first});
+    return cnt;
+  }
+
+  void Janosh::invalidateCaches() {
+    DirectoryCache::invalidateAll();
+    if(ValueCache* vc = ValueCache::getInstance())
+      vc->clear();
+    MemberIndex::invalidateAll();
+  }
+
+  /**
+   * Rewrites all records whose keys still use the legacy array index encoding.
+   * Re-encoded keys sort after their legacy counterparts, so a single pass suffices.
+   * @return number of migrated records.
+   */
+  size_t Janosh::migrate() {
+    janosh::Cursor* cur = Record::getDB()->cursor();
+    BulkWriter writer(Record::getDB(), settings_.bulkBatchSize);
+    string key,value;
+    size_t cnt = 0;
+    cur->jump();
+
+    try {
+      while(cur->get(&key, &value, true) && key.at(0) == '/') {
+        const string& migrated = Path(key).key();
+        if(migrated != key) {
+          LOG_DEBUG_MSG("migrate", key + " -> " + migrated);
+          writer.set(migrated, value);
+          writer.remove(key);
+          ++cnt;
+        }
+      }
+      writer.flush();
+    } catch(...) {
+      delete cur;
+      throw;
+    }
+    delete cur;
+    return cnt;
+  }
+
+  /**
+   * Prints the paths of the elements whose indexed value lies within a range.
+   * @param pattern the pattern the index is defined with.
+   * @param from the lowest value to match.
+   * @param to the highest value to match.
+   * @param out the output stream
+   * @return number of matching elements
+   */
+  size_t Janosh::query(const string& pattern, const string& from, const string& to, ostream& out) {
+    vector<string> elements;
+    SecondaryIndex::query(pattern, from, to, elements);
+    const bool sparse = SparseArray::enabled();
+    for(const string& e : elements) {
+      out << (sparse ? logical(Path(e)).pretty() : e) << '\n';
+    }
+    return elements.size();
+  }
+
+  /**
+   * Recreates a secondary index from the records it covers.
+   * @param pattern the pattern the index is defined with.
+   * @return number of indexed elements
+   */
+  size_t Janosh::buildIndex(const string& pattern) {
+    return SecondaryIndex::rebuild(pattern, settings_.scanChunkSize);
+  }
+
+  /**
+   * Prints runtime statistics of the daemon as "name value" lines.
+   * @param out the output stream
+   * @return number of printed statistics
+   */
+  size_t Janosh::stats(ostream& out) {
+    out << "cursorpool.hits " << RecordPool::hits() << '\n';
+    out << "cursorpool.misses " << RecordPool::misses() << '\n';
+    out << "dircache.hits " << DirectoryCache::hits() << '\n';
+    out << "dircache.misses " << DirectoryCache::misses() << '\n';
+    size_t cnt = 4;
+    if(ValueCache* vc = ValueCache::getInstance()) {
+      size_t hits = vc->hits();
+      size_t lookups = hits + vc->misses();
+      out << "valuecache.size " << vc->size() << '\n';
+      out << "valuecache.hits " << hits << '\n';
+      out << "valuecache.misses " << vc->misses() << '\n';
+      out << "valuecache.hitrate " << (lookups > 0 ? (double)hits / lookups : 0.0) << '\n';
+      cnt += 4;
+    }
+    out << "memberindex.hits " << MemberIndex::hits() << '\n';
+    out << "memberindex.misses " << MemberIndex::misses() << '\n';
+    out << "jsonpathcache.hits " << JsonPathCache::hits() << '\n';
+    out << "jsonpathcache.misses " << JsonPathCache::misses() << '\n';
+    cnt += 4;
+    return cnt;
+  }
+
   /**
    * Returns the size of a directory record
    * @param rec the directory record
@@ -872,16 +1264,21 @@ namespace janosh {
     }
 
     size_t s = dest.getSize();
+    //the keys of sparse arrays may continue past their size and are spaced out
+    const bool sparse = SparseArray::matches(dest.path());
+    size_t index = sparse ? SparseArray::next(dest.path(), s) : s;
+    const size_t step = sparse ? SparseArray::GAP : 1;
     size_t cnt = 0;
+    BulkWriter writer(Record::getDB(), settings_.bulkBatchSize);
 
     for(; begin != end; ++begin) {
-      announceOperation(dest.path().withChild(s + cnt).pretty(), (*begin).makeDBString(), Tracker::WRITE);
-      if(!Record::getDB()->add(dest.path().withChild(s + cnt), (*begin).makeDBString())) {
-        throw janosh_exception() << record_info({"Failed to add target", dest});
-      }
+      const Path& target = dest.path().withChild(index + cnt * step);
+      announceOperation(target.pretty(), (*begin).makeDBString(), Tracker::WRITE);
+      writer.set(target, (*begin).makeDBString());
       ++cnt;
     }
 
+    writer.flush();
     setContainerSize(dest, s + cnt);
     return cnt;
   }
@@ -898,9 +1295,13 @@ namespace janosh {
 
     size_t n = src.getSize();
     size_t s = dest.getSize();
+    const bool sparse = dest.isArray() && SparseArray::matches(dest.path());
+    size_t index = sparse ? SparseArray::next(dest.path(), s) : s;
+    const size_t step = sparse ? SparseArray::GAP : 1;
     size_t cnt = 0;
     string path;
     string value;
+    BulkWriter writer(Record::getDB(), settings_.bulkBatchSize);
 
     for(; cnt < n; ++cnt) {
       if(cnt > 0)
@@ -918,7 +1319,7 @@ namespace janosh {
         if(dest.isObject()) {
           target = RecordPool::get(dest.path().withChild(src.path().name()).asDirectory());
         } else if(dest.isArray()) {
-          target = RecordPool::get(dest.path().withChild(s + cnt).asDirectory());
+          target = RecordPool::get(dest.path().withChild(index + cnt * step).asDirectory());
         } else {
           throw janosh_exception() << record_info({"can't append to a value", dest});
         }
@@ -937,15 +1338,10 @@ namespace janosh {
         }
       } else {
         if(dest.isArray()) {
-          Path target = dest.path().withChild(s + cnt);
+          //indices past the end of the array are always free
+          Path target = dest.path().withChild(index + cnt * step);
           announceOperation(target.pretty(), src.value().makeDBString(), Tracker::WRITE);
-
-          if(!Record::getDB()->add(
-              target,
-              src.value().makeDBString()
-          )) {
-            throw janosh_exception() << record_info({"add failed", RecordPool::get(target)});
-          }
+          writer.set(target, src.value().makeDBString());
         } else if(dest.isObject()) {
           Path target = dest.path().withChild(src.path().name());
           announceOperation(target.pretty(), src.value().makeDBString(), Tracker::WRITE);
@@ -955,10 +1351,12 @@ namespace janosh {
           )) {
             throw janosh_exception() << record_info({"add failed", RecordPool::get(target)});
           }
+          settleOperation(target.pretty(), src.value().makeDBString(), Tracker::WRITE);
         }
       }
     }
 
+    writer.flush();
     setContainerSize(dest, s + cnt);
     return cnt;
   }
@@ -1006,7 +1404,12 @@ namespace janosh {
       throw janosh_exception() << record_info({"shift is limited to operate within one array", dest});
     }
 
+    const Path& array = srcParent.path();
     size_t parentSize = srcParent.getSize();
+
+    if(SparseArray::matches(array))
+      return shiftSparse(array, parentSize, src, dest);
+
     size_t srcIndex = src.getIndex();
     size_t destIndex = dest.getIndex();
 
@@ -1014,53 +1417,81 @@ namespace janosh {
       throw janosh_exception() << record_info({"index out of bounds", src});
     }
 
-    bool back = srcIndex > destIndex;
-    Record forwardRec = src.clone().fetch();
-    Record backRec = src.clone().fetch();
+    if(srcIndex == destIndex)
+      return 1;
 
-    if(back) {
-      forwardRec.previous();
+    //rotate the elements between source and destination by one and put the source at the destination
+    if(srcIndex > destIndex) {
+      reindex(array, destIndex, srcIndex + 1, [&](const size_t& i) {
+        return i == srcIndex ? destIndex : i + 1;
+      });
     } else {
-      forwardRec.next();
+      reindex(array, srcIndex, destIndex + 1, [&](const size_t& i) {
+        return i == srcIndex ? destIndex : i - 1;
+      });
     }
 
-    Record tmp;
+    src = dest;
 
-    if(src.isDirectory()) {
-      tmp = makeTemp(src.getType());
-      Record wildcard = RecordPool::get(src.path().asWildcard());
-      this->append(wildcard, tmp);
-    } else {
-      tmp = makeTemp(Value::String);
-      this->set(tmp, src.value());
-    }
+    return 1;
+  }
 
+  /**
+   * Shifts an element of a sparse array by moving it to a free key between its new neighbours.
+   * Only the records of the moved element are rewritten. If the neighbours leave no room,
+   * the array is spread out once and the element is moved afterwards.
+   * @param array the path of the array.
+   * @param size the size of the array.
+   * @param src the element to move. Refers to its new key afterwards.
+   * @param dest the element whose position the moved element takes.
+   * @return 1 on success.
+   */
+  size_t Janosh::shiftSparse(const Path& array, const size_t size, Record& src, Record& dest) {
+    size_t srcIndex;
+    size_t destIndex;
+    if(!SparseArray::rank(array, size, src.path(), srcIndex) || !SparseArray::rank(array, size, dest.path(), destIndex)) {
+      throw janosh_exception() << record_info({"index out of bounds", src});
+    }
 
-    //Clang workaround for abs ambiguity
-    long signed int sz = (long signed int)destIndex - (long signed int)srcIndex;
-    if(sz < 0)
-      sz *= -1;
+    if(srcIndex == destIndex)
+      return 1;
 
-    for(int i=0; i < sz; ++i) {
-      replace(forwardRec, backRec);
-      if(back) {
-        backRec.previous();
-        forwardRec.previous();
-      } else {
-        backRec.next();
-        forwardRec.next();
-      }
+    size_t key;
+    if(!SparseArray::slot(array, size, srcIndex, destIndex, key)) {
+      respace(array, size);
+      if(!SparseArray::slot(array, size, srcIndex, destIndex, key))
+        throw db_exception() << string_info({"corrupted array detected", array.pretty()});
     }
 
-    tmp.fetch();
-    replace(tmp,dest);
-    Record tmpDir = RecordPool::get("/tmp/.");
-    remove(tmpDir);
-    src = dest;
+    Path element;
+    if(!SparseArray::element(array, size, srcIndex, element))
+      throw db_exception() << string_info({"corrupted array detected", array.pretty()});
+
+    const size_t from = element.parseIndex();
+    reindex(array, from, from + 1, [&](const size_t& i) { return key; });
+    src = RecordPool::get(array.withChild(key));
 
     return 1;
   }
 
+  /**
+   * Moves the elements of a sparse array to keys that are SparseArray::GAP apart, keeping their order.
+   * @param array the path of the array.
+   * @param size the size of the array.
+   * @return number of records rewritten.
+   */
+  size_t Janosh::respace(const Path& array, const size_t size) {
+    std::map<size_t, size_t> keys;
+    Path element;
+    for(size_t i = 0; i < size; ++i) {
+      if(!SparseArray::element(array, size, i, element))
+        throw db_exception() << string_info({"corrupted array detected", array.pretty()});
+      keys[element.parseIndex()] = (i + 1) * SparseArray::GAP;
+    }
+
+    return reindex(array, 0, 0, [&](const size_t& i) { return keys.at(i); });
+  }
+
   void Janosh::setContainerSize(Record container, const size_t s) {
     JANOSH_TRACE({container}, s);
     string containerValue;
@@ -1078,79 +1509,225 @@ namespace janosh {
     const string& new_value =
        (boost::format("%c%d") % t % (s)).str();
 
-    container.setValue(new_value);
-    announceOperation(container.path().pretty(), lexical_cast<string>(new_value), Tracker::WRITE);
+    //replace by key, the container might have been looked up without positioning its cursor.
+    //the descriptor is dropped from the cache. another thread might write it before this one could cache it.
+    announceOperation(container.path().pretty(), new_value, Tracker::WRITE);
+    if(!Record::getDB()->replace(container.path(), new_value))
+      throw db_exception() << record_info({"failed to update container size", container});
+    settleOperation(container.path().pretty(), new_value, Tracker::WRITE);
   }
 
   void Janosh::changeContainerSize(Record container, const size_t by) {
-    container.fetch();
+    container.lookup();
     setContainerSize(container, container.getSize() + by);
   }
 
-  size_t Janosh::patch(const Path& path, const Value& value) {
-    announceOperation(path.pretty(), value.makeDBString(), Tracker::WRITE);
-    if(value.getType() == Value::Object || value.getType() == Value::Array){
- //     return Record::getDB()->set(path, value.makeDBString()) ? 1 : 0;
-      return 1;
+  /**
+   * Evaluates a native JSONPath expression on a record. As with jsoncons the record is the only member of the root object.
+   * Leading member and index steps narrow the scan down to the subtree they address. The children of that subtree
+   * are then materialized one at a time and dropped unless the expression matches them.
+   * @param rec the record to evaluate the expression on.
+   * @param jsonPath the compiled expression.
+   * @param emit called with every match.
+   * @return number of matches.
+   */
+  size_t Janosh::select(Record rec, const JsonPath& jsonPath, JsonPath::Emit emit) {
+    JANOSH_TRACE({rec});
+    const vector<JsonPath::Step>& steps = jsonPath.steps();
+    const string name = rec.path().name().pretty();
+    size_t cnt = 0;
+    JsonPath::Emit counted = [&](const json& match) {
+      ++cnt;
+      emit(match);
+    };
+
+    rec.lookup();
+    if(!rec.exists())
+      throw janosh_exception() << record_info( { "Path not found", rec });
+
+    if(!steps.empty() && steps.front().type == JsonPath::CHILD && steps.front().name != name)
+      return 0;
+
+    //walk down the steps that address exactly one child
+    size_t k = 1;
+    Path target = rec.path();
+    bool narrow = rec.isDirectory() && !rec.path().isRoot() && !steps.empty()
+        && (steps.front().type == JsonPath::CHILD || steps.front().type == JsonPath::WILDCARD);
+
+    if(narrow) {
+      for(; k < steps.size(); ++k) {
+        if(steps[k].type == JsonPath::CHILD)
+          target = target.withChild(Component(steps[k].name));
+        else if(steps[k].type == JsonPath::INDEX) {
+          if(!element(target, steps[k].index, target))
+            return 0;
+        } else
+          break;
+      }
+    } else {
+      k = 0;
     }
-    else
-      return this->set(RecordPool::get(path), value);
-  }
 
-  size_t Janosh::patch(js::Value& v, Path& path) {
-    size_t cnt = 0;
-    if (v.type() == js::obj_type) {
-      cnt+=patch(v.get_obj(), path);
-    } else if (v.type() == js::array_type) {
-      cnt+=patch(v.get_array(), path);
-    } else if (v.type() == js::str_type) {
-      cnt+=this->patch(path, Value(v.get_str(), Value::String));
-    } else if (v.type() == js::int_type) {
-      cnt+=this->patch(path, Value(std::to_string(v.get_int64()), Value::Number));
-    } else if (v.type() == js::bool_type) {
-      cnt+=this->patch(path, Value(std::to_string(v.get_bool()), Value::Boolean));
-    } else if (v.type() == js::real_type) {
-      cnt+=this->patch(path, Value(std::to_string(v.get_real()), Value::Number));
+    Record dir = RecordPool::get(target.asDirectory());
+    if(!dir.lookup().exists()) {
+      Record leaf = RecordPool::get(target);
+      if(!leaf.lookup().exists())
+        return 0;
+
+      json value = JsonTreeBuilder::makeScalar(leaf.value());
+      if(narrow) {
+        if(k >= steps.size())
+          counted(value);
+      } else {
+        json root = json::object();
+        root[name] = value;
+        jsonPath.select(root, 0, counted);
+      }
+      return cnt;
+    }
+
+    const string prefix = target.basePath().key() + "/";
+    ScanIterator scan(Record::getDB(), prefix, prefix, settings_.scanChunkSize);
+    Tracker* tracker = Tracker::getInstancePerThread();
+    JsonTreeBuilder builder;
+    bool perChild = narrow && k < steps.size();
+    //elements of sparse arrays are matched by their logical index
+    const bool positional = dir.isArray() && SparseArray::matches(target);
+    size_t position = 0;
+    string child;
+    string current;
+    string key;
+    string dbValue;
+    vector<string> components;
+
+    while(scan.next(key, dbValue)) {
+      const Path path(key);
+      tracker->update(path.pretty(), dbValue, Tracker::READ);
+
+      const string rest = key.substr(prefix.size());
+      components.clear();
+      boost::split(components, rest, boost::is_any_of("/"));
+      bool isDir = components.back() == "!";
+      if(isDir)
+        components.pop_back();
+      for(string& c : components)
+        c = Component(c).pretty();
+
+      if(perChild) {
+        //the descriptor of the target itself
+        if(components.empty())
+          continue;
+
+        if(components.front() != child) {
+          if(!builder.empty())
+            jsonPath.selectChild(current, builder.root(), k, counted);
+          builder.reset();
+          child = components.front();
+          current = positional ? "#" + lexical_cast<string>(position++) : child;
+        }
+        components.erase(components.begin());
+      }
+
+      builder.add(components, isDir, Record::makeValue(path, dbValue));
+    }
+
+    if(builder.empty())
+      return cnt;
+
+    if(perChild) {
+      jsonPath.selectChild(current, builder.root(), k, counted);
+    } else if(narrow) {
+      counted(builder.root());
+    } else {
+      json root = json::object();
+      root[name] = builder.root();
+      jsonPath.select(root, 0, counted);
     }
 
     return cnt;
   }
 
-  size_t Janosh::patch(js::Object& obj, Path& path) {
-    size_t cnt = 0;
-    path.pushMember(".");
-    Record rec = RecordPool::get(path);
-    if(!rec.fetch().exists())
-      cnt+=this->makeObject(RecordPool::get(path));
-    path.pop();
-
-    for(js::Pair& p : obj) {
-      path.pushMember(p.name_);
-      cnt+=patch(p.value_, path);
-      path.pop();
-      ++cnt;
+  /**
+   * Moves a range of array elements to new indices. The element records are listed with one prefix scan
+   * and rewritten with bulk writes, so nested elements move without being copied record by record.
+   * Keys that aren't overwritten by a moved element are deleted. The size of the array isn't changed.
+   * @param array the path of the array.
+   * @param from the index of the first element to move.
+   * @param to the index after the last element to move. 0 moves all elements up to the end.
+   * @param remap maps the old index of an element to its new index.
+   * @return number of records rewritten.
+   */
+  size_t Janosh::reindex(const Path& array, const size_t from, const size_t to, IndexMap remap) {
+    const string prefix = array.basePath().key() + "/";
+    ScanIterator scan(Record::getDB(), prefix, array.withChild(from).key(), settings_.scanChunkSize);
+    std::map<string, string> moved;
+    std::vector<string> old;
+    string key, value;
+
+    while(scan.next(key, value)) {
+      const string rest = key.substr(prefix.size());
+      const size_t slash = rest.find('/');
+      Component c(rest.substr(0, slash));
+      if(!c.isIndex())
+        throw db_exception() << string_info({"corrupted array detected", array.pretty()});
+
+      size_t idx = lexical_cast<size_t>(c.pretty().substr(1));
+      if(to > 0 && idx >= to)
+        break;
+
+      const string to_key = prefix + Component("#" + lexical_cast<string>(remap(idx))).key() + (slash == string::npos ? "" : rest.substr(slash));
+      moved[to_key] = value;
+      old.push_back(key);
     }
 
-    return cnt;
+    BulkWriter writer(Record::getDB(), settings_.bulkBatchSize);
+    for(auto& p : moved) {
+      announceOperation(Path(p.first).pretty(), p.second, Tracker::WRITE);
+      writer.set(p.first, p.second);
+    }
+
+    for(const string& k : old) {
+      if(moved.find(k) == moved.end()) {
+        announceOperation(Path(k).pretty(), "", Tracker::DELETE);
+        writer.remove(k);
+      }
+    }
+    writer.flush();
+
+    return moved.size();
   }
 
-  size_t Janosh::patch(js::Array& array, Path& path) {
-    size_t cnt = 0;
-    int index = 0;
-    path.pushMember(".");
-    Record rec = RecordPool::get(path);
-    if(!rec.fetch().exists())
-      cnt+=this->makeArray(RecordPool::get(path));
-    else
-      index = this->size(RecordPool::get(path));
-    path.pop();
+  /**
+   * Writes the pending leaf records of a directory with one bulk read and one bulk write
+   * and grows the directory by the number of records that didn't exist before.
+   * @param dir the directory record the leafs belong to.
+   * @param leafs the leaf records to write. Cleared afterwards.
+   * @return number of records written.
+   */
+  size_t Janosh::patchLeafs(const Path& dir, std::map<string, string>& leafs) {
+    if(leafs.empty())
+      return 0;
 
-    for(js::Value& v : array){
-      path.pushIndex(index++);
-      cnt+=patch(v, path);
-      path.pop();
-      ++cnt;
+    std::vector<string> keys;
+    std::map<string, string> existing;
+    for(auto& p : leafs) {
+      keys.push_back(p.first);
+      announceOperation(Path(p.first).pretty(), p.second, Tracker::WRITE);
+    }
+
+    if(Record::getDB()->get_bulk(keys, &existing) < 0 || Record::getDB()->set_bulk(leafs) < 0) {
+      throw db_exception() << string_info({"bulk patch failed", dir.pretty()});
     }
+
+    for(auto& p : leafs)
+      settleOperation(Path(p.first).pretty(), p.second, Tracker::WRITE);
+
+    size_t added = leafs.size() - existing.size();
+    if(added > 0)
+      changeContainerSize(RecordPool::get(dir), added);
+
+    size_t cnt = leafs.size();
+    leafs.clear();
     return cnt;
   }
 
@@ -1162,85 +1739,135 @@ namespace janosh {
   }
 
   size_t Janosh::loadJson(std::istream& is) {
-    js::Value rootValue;
-    js::read(is, rootValue);
+    JsonLoader loader(this, JsonLoader::LOAD);
+    return loader.load(is);
+  }
 
-    Path path;
-    return load(rootValue, path);
+  size_t Janosh::import(const string& jsonfile, Record target) {
+    std::ifstream is(jsonfile.c_str());
+    size_t cnt = this->import(is, target);
+    is.close();
+    return cnt;
   }
 
-  size_t Janosh::load(const Path& path, const Value& value) {
-    announceOperation(path.pretty(), value.makeDBString(), Tracker::WRITE);
-    return Record::getDB()->set(path, value.makeDBString()) ? 1 : 0;
+  /**
+   * Imports a json document into a directory using multiple threads.
+   * @param is the input stream
+   * @param target the root or a directory that doesn't exist yet
+   * @return number of records written
+   */
+  size_t Janosh::import(std::istream& is, Record target) {
+    JANOSH_TRACE({target});
+    Importer importer(this, target, settings_.importThreads);
+    return importer.import(is);
   }
 
-  size_t Janosh::load(js::Value& v, Path& path) {
-    size_t cnt = 0;
-    if (v.type() == js::obj_type) {
-      cnt+=load(v.get_obj(), path);
-    } else if (v.type() == js::array_type) {
-      cnt+=load(v.get_array(), path);
-    } else if (v.type() == js::str_type) {
-      cnt+=this->load(path, Value(v.get_str(), Value::String));
-    } else if (v.type() == js::int_type) {
-      cnt+=this->load(path, Value(std::to_string(v.get_int()), Value::Number));
-    } else if (v.type() == js::bool_type) {
-      cnt+=this->load(path, Value(std::to_string(v.get_bool()), Value::Boolean));
-    } else if (v.type() == js::real_type) {
-      cnt+=this->load(path, Value(std::to_string(v.get_real()), Value::Number));
-    }
+  bool Janosh::boundsCheck(Record p) {
+    Record parent = p.parent();
 
-    return cnt;
+    p.fetch();
+    parent.lookup();
+
+    if(parent.path().isRoot() || !parent.isArray())
+      return true;
+
+    //elements of sparse arrays are addressed by key. their logical indices are checked by resolve()
+    return SparseArray::matches(parent.path()) || p.path().parseIndex() <= parent.getSize();
   }
 
-  size_t Janosh::load(js::Object& obj, Path& path) {
-    size_t cnt = 0;
-    path.pushMember(".");
-    cnt+=this->load(path, Value((boost::format("O%d") % obj.size()).str(), Value::Object));
-    path.pop();
-
-    for(js::Pair& p : obj) {
-      path.pushMember(p.name_);
-      cnt+=load(p.value_, path);
-      path.pop();
-      ++cnt;
+  /**
+   * Resolves the logical indices of sparse arrays in a requested path to the keys of the elements.
+   * An index equal to the size of a sparse array names the key the next element is appended at.
+   * @param path a pretty path
+   * @return the path of the record
+   */
+  Path Janosh::resolve(const string& path) {
+    Path requested(path);
+    if(!SparseArray::enabled() || requested.isEmpty())
+      return requested;
+
+    vector<string> components;
+    boost::split(components, requested.pretty(), boost::is_any_of("/"));
+    Path resolved;
+
+    for(size_t i = 1; i < components.size(); ++i) {
+      Component c(components[i]);
+      if(c.isIndex() && SparseArray::matches(resolved)) {
+        Record array = RecordPool::get(resolved.asDirectory());
+        if(array.lookup().exists() && array.isArray()) {
+          const size_t n = lexical_cast<size_t>(c.pretty().substr(1));
+          const size_t size = array.getSize();
+          if(n == size)
+            resolved = resolved.withChild(SparseArray::next(array.path(), size));
+          else if(n > size || !SparseArray::element(array.path(), size, n, resolved))
+            throw janosh_exception() << string_info({"Out of array bounds", path});
+          continue;
+        }
+      }
+      resolved = resolved.withChild(c);
     }
 
-    return cnt;
+    return resolved;
   }
 
-  size_t Janosh::load(js::Array& array, Path& path) {
-    size_t cnt = 0;
-    int index = 0;
-    path.pushMember(".");
-    cnt+=this->load(path, Value((boost::format("A%d") % array.size()).str(), Value::Array));
-    path.pop();
-
-    for(js::Value& v : array){
-      path.pushIndex(index++);
-      cnt+=load(v, path);
-      path.pop();
-      ++cnt;
+  /**
+   * Looks up the n-th element of an array.
+   * @param array the path of the array.
+   * @param n the index of the element.
+   * @param element receives the path of the element, without "/." for directories.
+   * @return false if a sparse array has no n-th element. the element of other arrays might not exist either.
+   */
+  bool Janosh::element(const Path& array, const size_t n, Path& element) {
+    if(SparseArray::matches(array)) {
+      Record dir = RecordPool::get(array.asDirectory());
+      if(dir.lookup().exists() && dir.isArray())
+        return SparseArray::element(dir.path(), dir.getSize(), n, element);
     }
-    return cnt;
-  }
 
-  bool Janosh::boundsCheck(Record p) {
-    Record parent = p.parent();
+    element = array.withChild(n);
+    return true;
+  }
 
-    p.fetch();
-    parent.fetch();
+  /**
+   * Replaces the keys of sparse array elements in a path by their logical indices for printing.
+   * @param path the path of a record.
+   * @return the path with logical indices.
+   */
+  Path Janosh::logical(const Path& path) {
+    vector<string> keys;
+    boost::split(keys, path.key(), boost::is_any_of("/"));
+    Path base;
+    Path shown;
+
+    for(size_t i = 1; i < keys.size(); ++i) {
+      Component c(keys[i]);
+      size_t n;
+      if(c.isIndex() && SparseArray::matches(base)) {
+        Record array = RecordPool::get(base.asDirectory());
+        base = base.withChild(c);
+        if(array.lookup().exists() && array.isArray() && SparseArray::rank(array.path(), array.getSize(), base, n)) {
+          shown = shown.withChild(n);
+          continue;
+        }
+      } else {
+        base = base.withChild(c);
+      }
+      shown = shown.withChild(c);
+    }
 
-    return (parent.path().isRoot() || (!parent.isArray() || p.path().parseIndex() <= parent.getSize()));
+    return shown;
   }
 }
 
-std::map<std::thread::id, kyototycoon::RemoteDB*> janosh::Record::db;
+std::map<std::thread::id, janosh::StorageBackend*> janosh::Record::db;
+std::mutex janosh::Record::dbMutex;
+thread_local janosh::StorageBackend* janosh::Record::threadDB = NULL;
 
 void printCommands() {
     std::cerr
         << "Commands: " << endl
         <<  "  load" << endl
+        <<  "  import" << endl
         <<  "  set"  << endl
         <<  "  add" << endl
         <<  "  replace" << endl
@@ -1257,6 +1884,12 @@ void printCommands() {
         <<  "  mkobj" << endl
         <<  "  hash" << endl
         <<  "  publish" << endl
+        <<  "  migrate" << endl
+        <<  "  setraw" << endl
+        <<  "  stats" << endl
+        <<  "  query" << endl
+        <<  "  buildindex" << endl
+        <<  "  batch" << endl
         << endl;
       exit(0);
 }
@@ -1291,7 +1924,7 @@ int main(int argc, char** argv) {
       ("ktopts,O", po::value<string>(&ktopts), "The kyototycoon command line options. Do not include -th because it is set based on number of janosh threads.")
       ("bind,B", po::value<string>(&bindUrl), "The zmq url to bind to.")
       ("connect,C", po::value<string>(&connectUrl), "The zmq url to connect to.")
-      ("maxthreads,M", po::value<int>(&maxThreads), "The maximum number of janosh threads. should be a maximum of half the cpu cores")
+      ("maxthreads,M", po::value<int>(&maxThreads), "The number of worker threads that serve client connections. should be a maximum of half the cpu cores")
       ("json,j", "Produce json output")
       ("raw,r", "Produce raw output")
       ("bash,b", "Produce bash output")
@@ -1370,6 +2003,12 @@ int main(int argc, char** argv) {
       Logger::setTracing(tracing);
       Logger::setDBLogging(dblog);
       Tracker::setPrintDirective(printDirective);
+      DirectoryCache::setScope(settings.directoryCacheScope);
+      ValueCache::init(settings.valueCacheCapacity, settings.valueCacheShards);
+      MemberIndex::setCapacity(settings.memberIndexCapacity);
+      JsonPathCache::setCapacity(settings.jsonPathCacheSize);
+      SecondaryIndex::define(settings.indexes);
+      SparseArray::define(settings.sparseArrays);
       if(luafile.empty()) {
         TcpServer* server = TcpServer::getInstance(settings, maxThreads);
         server->open(bindUrl);
@@ -1416,15 +2055,21 @@ int main(int argc, char** argv) {
         lua::LuaScript::init([&](){
           client.connect(connectUrl);
         },[&](Request& req){
-          std::stringstream ss;
-          int rc = client.run(req, ss);
-          return std::make_pair(rc, ss.str());
+          string payload;
+          int rc = client.run(req, payload);
+          return std::make_pair(rc, std::move(payload));
         },[&](bool commit){
           try {
           client.close(commit);
           } catch (std::exception& ex) {
             LOG_DEBUG_MSG("client.close() threw: ",ex.what());
           }
+        },[&](Request& req){
+          return client.submit(req);
+        },[&](){
+          string payload;
+          int rc = client.collect(payload);
+          return std::make_pair(rc, std::move(payload));
         });
 
         lua::LuaScript* script = lua::LuaScript::getInstance();
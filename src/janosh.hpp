@@ -5,12 +5,14 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <functional>
 
 #include "settings.hpp"
 #include "record.hpp"
 #include "format.hpp"
 #include "print_visitor.hpp"
 #include "request.hpp"
+#include "jsonpath.hpp"
 
 namespace janosh {
 
@@ -24,9 +26,34 @@ using std::istream;
 using std::ostream;
 
 class Command;
+class FetchPool;
 typedef map<const std::string, Command*> CommandMap;
+typedef std::function<size_t(const size_t&)> IndexMap;
+typedef std::function<bool(string&, string&)> RecordSource;
+
+/**
+ * Options of a get request. Offset, limit and reverse select a page of an array.
+ * A limit of 0 reads up to the end.
+ * Fields projects objects (and the elements of arrays) to a list of relative paths like "name" or "address/city".
+ */
+struct GetOptions {
+  size_t offset = 0;
+  size_t limit = 0;
+  bool reverse = false;
+  vector<string> fields;
+
+  bool isPaged() const {
+    return offset > 0 || limit > 0 || reverse;
+  }
+
+  bool isSelective(const bool array) const {
+    return !fields.empty() || (array && isPaged());
+  }
+};
 
 class Janosh {
+  friend class JsonLoader;
+  friend class Importer;
 public:
   Settings& settings_;
   CommandMap cm_;
@@ -50,13 +77,15 @@ public:
   size_t patch(istream& is);
   size_t loadJson(const string& jsonfile);
   size_t loadJson(istream& is);
+  size_t import(const string& jsonfile, Record target);
+  size_t import(istream& is, Record target);
 
   size_t makeArray(Record target, size_t size = 0, bool boundsCheck = true);
   size_t makeObject(Record target, size_t size = 0);
   size_t makeDirectory(Record target, Value::Type type, size_t size = 0);
   size_t filter(vector<Record> targets, const std::string& jsonPathExps, std::ostream& out);
-  size_t get(vector<Record> targets, std::ostream& out);
-  size_t get(vector<Record> recs, PrintVisitor* vis,std::ostream& out);
+  size_t get(vector<Record> targets, std::ostream& out, const GetOptions& options = GetOptions());
+  size_t get(vector<Record> recs, PrintVisitor* vis,std::ostream& out, const GetOptions& options = GetOptions(), FetchPool* pool = NULL);
   size_t size(Record target);
   size_t remove(Record& target, bool pack = true);
   size_t random(Record rec, std::ostream& out);
@@ -77,6 +106,13 @@ public:
   size_t dump(ostream& out);
   size_t hash(ostream& out);
   size_t truncate();
+  size_t migrate();
+  size_t setRaw(const std::map<string, string>& recs);
+  size_t stats(ostream& out);
+  size_t query(const string& pattern, const string& from, const string& to, ostream& out);
+  size_t buildIndex(const string& pattern);
+
+  Path resolve(const string& path);
 
 private:
   Format format;
@@ -86,21 +122,23 @@ private:
 
   Format getFormat();
   void setContainerSize(Record rec, const size_t s);
+  void invalidateCaches();
   void changeContainerSize(Record rec, const size_t by);
-  size_t patch(const Path& path, const Value& value);
-  size_t patch(js::Value& v, Path& path);
-  size_t patch(js::Object& obj, Path& path);
-  size_t patch(js::Array& array, Path& path);
-  size_t load(const Path& path, const Value& value);
-  size_t load(js::Value& v, Path& path);
-  size_t load(js::Object& obj, Path& path);
-  size_t load(js::Array& array, Path& path);
+  size_t patchLeafs(const Path& dir, std::map<string, string>& leafs);
+  size_t reindex(const Path& array, const size_t from, const size_t to, IndexMap remap);
+  size_t shiftSparse(const Path& array, const size_t size, Record& src, Record& dest);
+  size_t respace(const Path& array, const size_t size);
+  size_t select(Record rec, const JsonPath& jsonPath, JsonPath::Emit emit);
+  PrintVisitor* makeVisitor(std::ostream& out);
 
   bool boundsCheck(Record p);
-  Record makeTemp(const Value::Type& t);
+  bool element(const Path& array, const size_t n, Path& element);
+  Path logical(const Path& path);
 
   size_t recurseDirectory(Record& travRoot, PrintVisitor* vis, Value::Type rootType, ostream& out);
   size_t recurseValue(Record& travRoot, PrintVisitor* vis, Value::Type rootType, ostream& out);
+  size_t recurseSelection(Record& dir, const GetOptions& options, PrintVisitor* vis, Value::Type rootType);
+  size_t render(const Path& travRoot, RecordSource next, PrintVisitor* vis, Value::Type rootType);
 
 };
 
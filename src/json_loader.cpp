@@ -0,0 +1,180 @@
+#include <boost/format.hpp>
+#include "json_loader.hpp"
+#include "janosh.hpp"
+#include "exception.hpp"
+#include "tracker.hpp"
+#include "sparse_array.hpp"
+
+namespace janosh {
+
+  JsonLoader::JsonLoader(Janosh* janosh, const Mode& mode) :
+      janosh_(janosh),
+      mode_(mode),
+      writer_(Record::getDB(), janosh->settings_.bulkBatchSize),
+      cnt_(0) {
+  }
+
+  size_t JsonLoader::load(std::istream& is) {
+    jsoncons::json_reader reader(is, *this);
+    reader.read();
+    return cnt_;
+  }
+
+  void JsonLoader::pushChild() {
+    if(stack_.empty())
+      return;
+
+    Frame& parent = stack_.back();
+    if(parent.type == Value::Array) {
+      path_.pushIndex(parent.index);
+      parent.index += parent.step;
+    }
+    else
+      path_.pushMember(name_);
+  }
+
+  void JsonLoader::popChild() {
+    if(!stack_.empty())
+      path_.pop();
+  }
+
+  void JsonLoader::beginDirectory(const Value::Type& type) {
+    pushChild();
+    Frame f;
+    f.dir = path_;
+    f.dir.pushMember(".");
+    f.type = type;
+    f.index = 0;
+    f.step = type == Value::Array && SparseArray::matches(f.dir) ? SparseArray::GAP : 1;
+    f.size = 0;
+
+    if(mode_ == PATCH) {
+      //nested directories are bounds checked against the array size
+      if(!stack_.empty() && stack_.back().type == Value::Array)
+        cnt_ += janosh_->patchLeafs(stack_.back().dir, stack_.back().leafs);
+
+      Record rec = RecordPool::get(f.dir);
+      if(!rec.fetch().exists()) {
+        if(type == Value::Array)
+          cnt_ += janosh_->makeArray(RecordPool::get(f.dir));
+        else
+          cnt_ += janosh_->makeObject(RecordPool::get(f.dir));
+      } else if(type == Value::Array) {
+        //the keys of sparse arrays may continue past their size
+        f.index = SparseArray::matches(f.dir) ? SparseArray::next(f.dir, rec.getSize()) : rec.getSize();
+      }
+    }
+
+    stack_.push_back(f);
+  }
+
+  void JsonLoader::endDirectory() {
+    Frame& f = stack_.back();
+
+    if(mode_ == LOAD) {
+      char t = (f.type == Value::Array ? 'A' : 'O');
+      const string& value = (boost::format("%c%d") % t % f.size).str();
+      Tracker::getInstancePerThread()->update(f.dir.pretty(), value, Tracker::WRITE);
+      writer_.set(f.dir, value);
+      ++cnt_;
+    } else {
+      cnt_ += janosh_->patchLeafs(f.dir, f.leafs);
+    }
+
+    stack_.pop_back();
+    popChild();
+
+    if(!stack_.empty())
+      ++stack_.back().size;
+  }
+
+  void JsonLoader::leaf(const Value& value) {
+    if(stack_.empty())
+      throw janosh_exception() << msg_info("the document root has to be an object or an array");
+
+    pushChild();
+    Frame& parent = stack_.back();
+
+    if(mode_ == LOAD) {
+      Tracker::getInstancePerThread()->update(path_.pretty(), value.makeDBString(), Tracker::WRITE);
+      writer_.set(path_, value.makeDBString());
+      ++cnt_;
+    } else {
+      parent.leafs[path_.key()] = value.makeDBString();
+      if(parent.leafs.size() >= janosh_->settings_.bulkBatchSize)
+        cnt_ += janosh_->patchLeafs(parent.dir, parent.leafs);
+    }
+
+    ++parent.size;
+    popChild();
+  }
+
+  void JsonLoader::do_begin_document() {
+  }
+
+  void JsonLoader::do_end_document() {
+    writer_.flush();
+  }
+
+  void JsonLoader::do_begin_object(const jsoncons::serializing_context& context) {
+    beginDirectory(Value::Object);
+  }
+
+  void JsonLoader::do_end_object(const jsoncons::serializing_context& context) {
+    endDirectory();
+  }
+
+  void JsonLoader::do_begin_array(const jsoncons::serializing_context& context) {
+    beginDirectory(Value::Array);
+  }
+
+  void JsonLoader::do_end_array(const jsoncons::serializing_context& context) {
+    endDirectory();
+  }
+
+  void JsonLoader::do_name(const string_view_type& name, const jsoncons::serializing_context& context) {
+    name_.assign(name.data(), name.length());
+  }
+
+  void JsonLoader::do_null_value(const jsoncons::serializing_context& context) {
+    if(stack_.empty())
+      throw janosh_exception() << msg_info("the document root has to be an object or an array");
+
+    //there is no record for null. it still counts towards the size of its container and takes up its index.
+    //sparse arrays look up elements by their records, so a null can't take up a position in them.
+    if(stack_.back().step == SparseArray::GAP)
+      return;
+
+    pushChild();
+    ++stack_.back().size;
+    popChild();
+  }
+
+  void JsonLoader::do_string_value(const string_view_type& value, const jsoncons::serializing_context& context) {
+    leaf(Value(string(value.data(), value.length()), Value::String));
+  }
+
+  void JsonLoader::do_byte_string_value(const uint8_t* data, size_t length, const jsoncons::serializing_context& context) {
+    throw janosh_exception() << msg_info("byte strings are not supported");
+  }
+
+  void JsonLoader::do_bignum_value(int signum, const uint8_t* data, size_t length, const jsoncons::serializing_context& context) {
+    throw janosh_exception() << msg_info("number out of range");
+  }
+
+  void JsonLoader::do_double_value(double value, const jsoncons::floating_point_options& fmt, const jsoncons::serializing_context& context) {
+    leaf(Value(std::to_string(value), Value::Number));
+  }
+
+  void JsonLoader::do_integer_value(int64_t value, const jsoncons::serializing_context& context) {
+    leaf(Value(std::to_string(value), Value::Number));
+  }
+
+  void JsonLoader::do_uinteger_value(uint64_t value, const jsoncons::serializing_context& context) {
+    leaf(Value(std::to_string(value), Value::Number));
+  }
+
+  void JsonLoader::do_bool_value(bool value, const jsoncons::serializing_context& context) {
+    leaf(Value(std::to_string(value), Value::Boolean));
+  }
+}
@@ -0,0 +1,82 @@
+#ifndef _JANOSH_JSON_LOADER_HPP
+#define _JANOSH_JSON_LOADER_HPP
+
+#include <map>
+#include <vector>
+#include <string>
+#include <jsoncons/json.hpp>
+#include "path.hpp"
+#include "value.hpp"
+#include "bulk_writer.hpp"
+
+namespace janosh {
+  using std::string;
+
+  class Janosh;
+
+  /**
+   * Receives the events of a streaming json parser and turns them into records as they arrive.
+   * Only the directories on the way from the document root to the current value are kept in memory.
+   */
+  class JsonLoader : public jsoncons::json_content_handler {
+  public:
+    enum Mode {
+      //blindly write all records. container sizes are written when the container ends
+      LOAD,
+      //merge the document into existing records
+      PATCH
+    };
+
+  private:
+    struct Frame {
+      Path dir;
+      Value::Type type;
+      size_t index;
+      size_t step;
+      size_t size;
+      std::map<string, string> leafs;
+    };
+
+    Janosh* janosh_;
+    Mode mode_;
+    Path path_;
+    string name_;
+    std::vector<Frame> stack_;
+    BulkWriter writer_;
+    size_t cnt_;
+
+    void pushChild();
+    void popChild();
+    void beginDirectory(const Value::Type& type);
+    void endDirectory();
+    void leaf(const Value& value);
+
+    void do_begin_document() override;
+    void do_end_document() override;
+    void do_begin_object(const jsoncons::serializing_context& context) override;
+    void do_end_object(const jsoncons::serializing_context& context) override;
+    void do_begin_array(const jsoncons::serializing_context& context) override;
+    void do_end_array(const jsoncons::serializing_context& context) override;
+    void do_name(const string_view_type& name, const jsoncons::serializing_context& context) override;
+    void do_null_value(const jsoncons::serializing_context& context) override;
+    void do_string_value(const string_view_type& value, const jsoncons::serializing_context& context) override;
+    void do_byte_string_value(const uint8_t* data, size_t length, const jsoncons::serializing_context& context) override;
+    void do_bignum_value(int signum, const uint8_t* data, size_t length, const jsoncons::serializing_context& context) override;
+    void do_double_value(double value, const jsoncons::floating_point_options& fmt, const jsoncons::serializing_context& context) override;
+    void do_integer_value(int64_t value, const jsoncons::serializing_context& context) override;
+    void do_uinteger_value(uint64_t value, const jsoncons::serializing_context& context) override;
+    void do_bool_value(bool value, const jsoncons::serializing_context& context) override;
+
+  public:
+    JsonLoader(Janosh* janosh, const Mode& mode);
+
+    /**
+     * Parses the stream incrementally and writes the records.
+     * @param is the input stream
+     * @return number of records written
+     */
+    size_t load(std::istream& is);
+  };
+}
+
+#endif
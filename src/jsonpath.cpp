@@ -0,0 +1,403 @@
+#include <cstring>
+#include <stdexcept>
+#include <boost/lexical_cast.hpp>
+#include "jsonpath.hpp"
+#include "exception.hpp"
+
+namespace janosh {
+  using jsoncons::json;
+  using std::invalid_argument;
+  using boost::lexical_cast;
+
+  JsonPath::JsonPath(const string& expr) : expr_(expr), native_(true) {
+    try {
+      parse();
+    } catch(std::exception& ex) {
+      native_ = false;
+      steps_.clear();
+    }
+  }
+
+  const string& JsonPath::expression() const {
+    return expr_;
+  }
+
+  bool JsonPath::isNative() const {
+    return native_;
+  }
+
+  const vector<JsonPath::Step>& JsonPath::steps() const {
+    return steps_;
+  }
+
+  void JsonPath::skipSpace(size_t& pos) const {
+    while(pos < expr_.size() && std::isspace(expr_[pos]))
+      ++pos;
+  }
+
+  string JsonPath::parseName(size_t& pos, const char* delimiters) const {
+    size_t start = pos;
+    while(pos < expr_.size() && !std::isspace(expr_[pos]) && std::strchr(delimiters, expr_[pos]) == NULL)
+      ++pos;
+
+    if(pos == start)
+      throw invalid_argument("expected a name: " + expr_);
+    return expr_.substr(start, pos - start);
+  }
+
+  string JsonPath::parseQuoted(size_t& pos) const {
+    const char quote = expr_[pos++];
+    string s;
+    while(pos < expr_.size() && expr_[pos] != quote) {
+      if(expr_[pos] == '\\' && pos + 1 < expr_.size())
+        ++pos;
+      s.push_back(expr_[pos++]);
+    }
+
+    if(pos >= expr_.size())
+      throw invalid_argument("unterminated string: " + expr_);
+    ++pos;
+    return s;
+  }
+
+  json JsonPath::parseLiteral(size_t& pos) const {
+    if(pos >= expr_.size())
+      throw invalid_argument("expected a literal: " + expr_);
+
+    const char& c = expr_[pos];
+    if(c == '\'' || c == '"')
+      return json(parseQuoted(pos));
+
+    if(expr_.compare(pos, 4, "true") == 0) {
+      pos += 4;
+      return json(true);
+    } else if(expr_.compare(pos, 5, "false") == 0) {
+      pos += 5;
+      return json(false);
+    } else if(expr_.compare(pos, 4, "null") == 0) {
+      pos += 4;
+      return json(jsoncons::null_type());
+    }
+
+    size_t start = pos;
+    while(pos < expr_.size() && std::strchr("+-0123456789.eE", expr_[pos]) != NULL)
+      ++pos;
+    const string num = expr_.substr(start, pos - start);
+    if(num.find_first_of(".eE") == string::npos)
+      return json(lexical_cast<int64_t>(num));
+    else
+      return json(lexical_cast<double>(num));
+  }
+
+  void JsonPath::parseFilter(size_t& pos, Step& step) const {
+    step.type = FILTER;
+    step.op = EXISTS;
+    skipSpace(pos);
+    if(pos >= expr_.size() || expr_[pos] != '@')
+      throw invalid_argument("filters have to start with @: " + expr_);
+    ++pos;
+
+    while(pos < expr_.size()) {
+      if(expr_[pos] == '.') {
+        ++pos;
+        step.field.push_back(parseName(pos, ".[=!<>()&|"));
+      } else if(expr_[pos] == '[') {
+        ++pos;
+        skipSpace(pos);
+        if(pos < expr_.size() && (expr_[pos] == '\'' || expr_[pos] == '"'))
+          step.field.push_back(parseQuoted(pos));
+        else
+          step.field.push_back("#" + lexical_cast<string>(lexical_cast<size_t>(parseName(pos, "]"))));
+        skipSpace(pos);
+        if(pos >= expr_.size() || expr_[pos] != ']')
+          throw invalid_argument("expected ]: " + expr_);
+        ++pos;
+      } else {
+        break;
+      }
+    }
+
+    skipSpace(pos);
+    if(pos < expr_.size() && expr_[pos] == ')')
+      return;
+
+    static const std::pair<const char*, Operator> operators[] = {
+      {"==", EQ}, {"!=", NE}, {"<=", LE}, {">=", GE}, {"<", LT}, {">", GT}
+    };
+
+    bool found = false;
+    for(const auto& o : operators) {
+      size_t len = std::strlen(o.first);
+      if(expr_.compare(pos, len, o.first) == 0) {
+        step.op = o.second;
+        pos += len;
+        found = true;
+        break;
+      }
+    }
+
+    if(!found)
+      throw invalid_argument("unsupported filter: " + expr_);
+
+    skipSpace(pos);
+    step.literal = parseLiteral(pos);
+    skipSpace(pos);
+  }
+
+  void JsonPath::parseBracket(size_t& pos, Step& step) const {
+    skipSpace(pos);
+    if(pos >= expr_.size())
+      throw invalid_argument("unterminated bracket: " + expr_);
+
+    const char& c = expr_[pos];
+    if(c == '*') {
+      step.type = WILDCARD;
+      ++pos;
+    } else if(c == '\'' || c == '"') {
+      step.type = CHILD;
+      step.name = parseQuoted(pos);
+    } else if(std::isdigit(c)) {
+      step.type = INDEX;
+      step.index = lexical_cast<size_t>(parseName(pos, "]"));
+    } else if(c == '?') {
+      ++pos;
+      if(pos >= expr_.size() || expr_[pos] != '(')
+        throw invalid_argument("expected (: " + expr_);
+      ++pos;
+      parseFilter(pos, step);
+      if(pos >= expr_.size() || expr_[pos] != ')')
+        throw invalid_argument("expected ): " + expr_);
+      ++pos;
+    } else {
+      throw invalid_argument("unsupported bracket expression: " + expr_);
+    }
+
+    skipSpace(pos);
+    if(pos >= expr_.size() || expr_[pos] != ']')
+      throw invalid_argument("expected ]: " + expr_);
+    ++pos;
+  }
+
+  void JsonPath::parse() {
+    size_t pos = 0;
+    skipSpace(pos);
+    if(pos >= expr_.size() || expr_[pos] != '$')
+      throw invalid_argument("expressions have to start with $: " + expr_);
+    ++pos;
+
+    while(pos < expr_.size()) {
+      Step step;
+      if(expr_.compare(pos, 2, "..") == 0) {
+        pos += 2;
+        if(pos < expr_.size() && expr_[pos] == '*') {
+          ++pos;
+        } else if(pos < expr_.size() && expr_[pos] == '[') {
+          ++pos;
+          parseBracket(pos, step);
+          if(step.type != CHILD && step.type != WILDCARD)
+            throw invalid_argument("unsupported descent: " + expr_);
+        } else {
+          step.name = parseName(pos, ".[");
+        }
+        step.type = DESCENT;
+      } else if(expr_[pos] == '.') {
+        ++pos;
+        if(pos < expr_.size() && expr_[pos] == '*') {
+          ++pos;
+          step.type = WILDCARD;
+        } else {
+          step.type = CHILD;
+          step.name = parseName(pos, ".[");
+        }
+      } else if(expr_[pos] == '[') {
+        ++pos;
+        parseBracket(pos, step);
+      } else {
+        throw invalid_argument("unexpected character: " + expr_);
+      }
+      steps_.push_back(step);
+    }
+  }
+
+  bool JsonPath::test(const Step& step, const json& node) const {
+    const json* cur = &node;
+    for(const string& f : step.field) {
+      if(cur->is_array() && !f.empty() && f[0] == '#') {
+        size_t i = lexical_cast<size_t>(f.substr(1));
+        if(i >= cur->size())
+          return false;
+        cur = &(*cur)[i];
+      } else if(cur->is_object()) {
+        auto it = cur->find(f);
+        if(it == cur->end_members())
+          return false;
+        cur = &(*it).value();
+      } else {
+        return false;
+      }
+    }
+
+    if(step.op == EXISTS)
+      return true;
+
+    int cmp;
+    if(step.literal.is_number() && cur->is_number()) {
+      double a = cur->as_double();
+      double b = step.literal.as_double();
+      cmp = (a < b) ? -1 : (a > b ? 1 : 0);
+    } else if(step.literal.is_string() && cur->is_string()) {
+      cmp = cur->as<string>().compare(step.literal.as<string>());
+    } else if(step.literal.is_bool() && cur->is_bool()) {
+      cmp = cur->as_bool() == step.literal.as_bool() ? 0 : 1;
+      if(step.op != EQ && step.op != NE)
+        return false;
+    } else if(step.literal.is_null() && cur->is_null()) {
+      cmp = 0;
+    } else {
+      return step.op == NE;
+    }
+
+    switch(step.op) {
+    case EQ:
+      return cmp == 0;
+    case NE:
+      return cmp != 0;
+    case LT:
+      return cmp < 0;
+    case LE:
+      return cmp <= 0;
+    case GT:
+      return cmp > 0;
+    case GE:
+      return cmp >= 0;
+    default:
+      return false;
+    }
+  }
+
+  void JsonPath::select(const json& node, const size_t k, Emit emit) const {
+    if(k >= steps_.size()) {
+      emit(node);
+      return;
+    }
+
+    const Step& step = steps_[k];
+    if(step.type == CHILD) {
+      if(node.is_object()) {
+        auto it = node.find(step.name);
+        if(it != node.end_members())
+          select((*it).value(), k + 1, emit);
+      }
+    } else if(step.type == INDEX) {
+      if(node.is_array() && step.index < node.size())
+        select(node[step.index], k + 1, emit);
+    } else if(node.is_object()) {
+      for(const auto& member : node.members()) {
+        selectChild(string(member.key().data(), member.key().length()), member.value(), k, emit);
+      }
+    } else if(node.is_array()) {
+      size_t i = 0;
+      for(const auto& element : node.elements()) {
+        selectChild("#" + lexical_cast<string>(i++), element, k, emit);
+      }
+    }
+  }
+
+  void JsonPath::selectChild(const string& name, const json& child, const size_t k, Emit emit) const {
+    const Step& step = steps_[k];
+    switch(step.type) {
+    case CHILD:
+      if(name == step.name)
+        select(child, k + 1, emit);
+      break;
+    case INDEX:
+      if(name == "#" + lexical_cast<string>(step.index))
+        select(child, k + 1, emit);
+      break;
+    case WILDCARD:
+      select(child, k + 1, emit);
+      break;
+    case FILTER:
+      if(test(step, child))
+        select(child, k + 1, emit);
+      break;
+    case DESCENT:
+      if(step.name.empty() || name == step.name)
+        select(child, k + 1, emit);
+      select(child, k, emit);
+      break;
+    }
+  }
+
+  JsonTreeBuilder::JsonTreeBuilder() : empty_(true) {
+  }
+
+  json JsonTreeBuilder::makeScalar(const Value& value) {
+    const string s = value.str();
+    if(value.getType() == Value::Number) {
+      //same conversion as JsonPathVisitor so both evaluation paths yield equal results
+      return json(std::stol(s));
+    } else if(value.getType() == Value::Boolean) {
+      return json(s == "true");
+    }
+    return json(s);
+  }
+
+  json& JsonTreeBuilder::child(json& node, const size_t depth, const string& name) {
+    if(node.is_array()) {
+      //the records below an element directly follow its descriptor
+      if(depth >= elements_.size() || elements_[depth] != name || node.size() == 0)
+        throw db_exception() << string_info({"corrupted array detected", name});
+      return node[node.size() - 1];
+    }
+
+    auto it = node.find(name);
+    if(it == node.end_members()) {
+      node[name] = json::object();
+      return node.at(name);
+    }
+    return (*it).value();
+  }
+
+  void JsonTreeBuilder::add(const vector<string>& components, const bool directory, const Value& value) {
+    json v;
+    if(directory)
+      v = (value.getType() == Value::Array) ? json(json::array()) : json(json::object());
+    else
+      v = makeScalar(value);
+
+    if(components.empty()) {
+      root_ = v;
+      empty_ = false;
+      return;
+    }
+
+    json* node = &root_;
+    const size_t depth = components.size() - 1;
+    for(size_t i = 0; i < depth; ++i)
+      node = &child(*node, i, components[i]);
+
+    const string& name = components.back();
+    if(node->is_array()) {
+      node->push_back(v);
+      elements_.resize(depth + 1);
+      elements_[depth] = name;
+    } else {
+      (*node)[name] = v;
+    }
+  }
+
+  void JsonTreeBuilder::reset() {
+    root_ = json();
+    empty_ = true;
+    elements_.clear();
+  }
+
+  bool JsonTreeBuilder::empty() const {
+    return empty_;
+  }
+
+  const json& JsonTreeBuilder::root() const {
+    return root_;
+  }
+}
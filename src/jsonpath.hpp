@@ -0,0 +1,104 @@
+#ifndef _JANOSH_JSONPATH_HPP
+#define _JANOSH_JSONPATH_HPP
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <jsoncons/json.hpp>
+#include "value.hpp"
+
+namespace janosh {
+  using std::string;
+  using std::vector;
+
+  /**
+   * A compiled JSONPath expression that is evaluated natively on janosh trees.
+   * Supported are $, .name, ['name'], [n], .*, [*], ..name, ..* and filters of the form
+   * [?(@.a.b <op> literal)] or [?(@.a)] with the operators ==, !=, <, <=, > and >=.
+   * Other expressions aren't native and have to be evaluated by jsoncons.
+   */
+  class JsonPath {
+  public:
+    enum StepType {
+      CHILD, INDEX, WILDCARD, DESCENT, FILTER
+    };
+
+    enum Operator {
+      EXISTS, EQ, NE, LT, LE, GT, GE
+    };
+
+    struct Step {
+      StepType type;
+      //member name of CHILD and DESCENT steps. empty for a descending wildcard.
+      string name;
+      size_t index;
+      //the path below @ a FILTER step tests. array indices are written as "#n".
+      vector<string> field;
+      Operator op;
+      jsoncons::json literal;
+    };
+
+    typedef std::function<void(const jsoncons::json&)> Emit;
+
+  private:
+    string expr_;
+    vector<Step> steps_;
+    bool native_;
+
+    void parse();
+    void parseBracket(size_t& pos, Step& step) const;
+    void parseFilter(size_t& pos, Step& step) const;
+    string parseName(size_t& pos, const char* delimiters) const;
+    string parseQuoted(size_t& pos) const;
+    jsoncons::json parseLiteral(size_t& pos) const;
+    void skipSpace(size_t& pos) const;
+    bool test(const Step& step, const jsoncons::json& node) const;
+  public:
+    explicit JsonPath(const string& expr);
+
+    const string& expression() const;
+    bool isNative() const;
+    const vector<Step>& steps() const;
+
+    /**
+     * Applies the steps starting at step k to a node and emits every match.
+     */
+    void select(const jsoncons::json& node, const size_t k, Emit emit) const;
+
+    /**
+     * Applies step k to a single child of a node and the remaining steps to what it matches.
+     * @param name the member name of the child or "#n" for array elements
+     */
+    void selectChild(const string& name, const jsoncons::json& child, const size_t k, Emit emit) const;
+  };
+
+  /**
+   * Builds a jsoncons tree from janosh records read in key order.
+   * Array elements are appended in the order they are read, so gaps between the keys of sparse arrays are closed.
+   */
+  class JsonTreeBuilder {
+    jsoncons::json root_;
+    bool empty_;
+    //the name of the element last appended to an array at each depth
+    vector<string> elements_;
+
+    jsoncons::json& child(jsoncons::json& node, const size_t depth, const string& name);
+  public:
+    JsonTreeBuilder();
+
+    /**
+     * Adds a record to the tree.
+     * @param components the pretty path components of the record relative to the root of the tree
+     * @param directory true if the record is the descriptor of a directory
+     * @param value the value of the record
+     */
+    void add(const vector<string>& components, const bool directory, const Value& value);
+    void reset();
+    bool empty() const;
+    const jsoncons::json& root() const;
+
+    static jsoncons::json makeScalar(const Value& value);
+  };
+}
+
+#endif
@@ -0,0 +1,53 @@
+#include "jsonpath_cache.hpp"
+
+namespace janosh {
+  std::mutex JsonPathCache::mutex_;
+  JsonPathCache::LruList JsonPathCache::lru_;
+  std::unordered_map<string, JsonPathCache::LruList::iterator> JsonPathCache::index_;
+  size_t JsonPathCache::capacity_ = 256;
+  std::atomic<size_t> JsonPathCache::hits_(0);
+  std::atomic<size_t> JsonPathCache::misses_(0);
+
+  JsonPathPtr JsonPathCache::get(const string& expr) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      auto it = index_.find(expr);
+      if(it != index_.end()) {
+        lru_.splice(lru_.begin(), lru_, (*it).second);
+        ++hits_;
+        return (*it).second->second;
+      }
+    }
+
+    //compile outside of the lock. concurrent misses of the same expression compile it twice.
+    ++misses_;
+    JsonPathPtr compiled = std::make_shared<const JsonPath>(expr);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(capacity_ == 0 || index_.find(expr) != index_.end())
+      return compiled;
+
+    lru_.push_front({expr, compiled});
+    index_[expr] = lru_.begin();
+    if(lru_.size() > capacity_) {
+      index_.erase(lru_.back().first);
+      lru_.pop_back();
+    }
+    return compiled;
+  }
+
+  void JsonPathCache::setCapacity(const size_t capacity) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    lru_.clear();
+    index_.clear();
+  }
+
+  size_t JsonPathCache::hits() {
+    return hits_;
+  }
+
+  size_t JsonPathCache::misses() {
+    return misses_;
+  }
+}
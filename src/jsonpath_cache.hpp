@@ -0,0 +1,42 @@
+#ifndef _JANOSH_JSONPATH_CACHE_HPP
+#define _JANOSH_JSONPATH_CACHE_HPP
+
+#include <list>
+#include <memory>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include "jsonpath.hpp"
+
+namespace janosh {
+  using std::string;
+
+  typedef std::shared_ptr<const JsonPath> JsonPathPtr;
+
+  /**
+   * A daemon wide LRU cache of compiled JSONPath expressions keyed by their text.
+   * Compiled expressions are immutable, so all worker threads share them.
+   */
+  class JsonPathCache {
+    typedef std::list<std::pair<string, JsonPathPtr>> LruList;
+
+    static std::mutex mutex_;
+    static LruList lru_;
+    static std::unordered_map<string, LruList::iterator> index_;
+    static size_t capacity_;
+    static std::atomic<size_t> hits_;
+    static std::atomic<size_t> misses_;
+  public:
+    /**
+     * Returns the compiled form of an expression, compiling it on a miss.
+     */
+    static JsonPathPtr get(const string& expr);
+
+    static void setCapacity(const size_t capacity);
+    static size_t hits();
+    static size_t misses();
+  };
+}
+
+#endif
@@ -372,6 +372,21 @@ static int l_request_trigger(lua_State* L) {
   return 2;
 }
 
+static int l_submit(lua_State* L) {
+  bool result = LuaScript::getInstance()->performSubmit(make_request(L));
+  lua_pushboolean(L, result);
+  return 1;
+}
+
+static int l_collect(lua_State* L) {
+  auto result = LuaScript::getInstance()->performCollect();
+
+  lua_pushnumber(L, result.first);
+  lua_pushstring(L, result.second.c_str());
+
+  return 2;
+}
+
 static int l_raw(lua_State* L) {
   string key = lua_tostring(L, -1);
   Request req(janosh::Format::Raw, "get", {{key, Value::String}}, false, false, get_parent_info(), "");
@@ -560,6 +575,10 @@ static void install_janosh_functions(lua_State* L, bool first) {
   lua_setglobal(L, "janosh_request");
   lua_pushcfunction(L, l_request_trigger);
   lua_setglobal(L, "janosh_request_t");
+  lua_pushcfunction(L, l_submit);
+  lua_setglobal(L, "janosh_submit");
+  lua_pushcfunction(L, l_collect);
+  lua_setglobal(L, "janosh_collect");
 
   // Load the Web.lua, set it to the Web table
   lua_getglobal(L, "require");
@@ -597,7 +616,11 @@ void printTransactionsHandler(int signum) {
 
 LuaScript::LuaScript(std::function<void()> openCallback,
     std::function<std::pair<int,string>(janosh::Request&)> requestCallback,
-    std::function<void(bool)> closeCallback, lua_State* l) : openCallback_(openCallback), requestCallback_(requestCallback), closeCallback_(closeCallback) {
+    std::function<void(bool)> closeCallback,
+    std::function<bool(janosh::Request&)> submitCallback,
+    std::function<std::pair<int,string>()> collectCallback, lua_State* l) :
+    openCallback_(openCallback), requestCallback_(requestCallback), closeCallback_(closeCallback),
+    submitCallback_(submitCallback), collectCallback_(collectCallback) {
   if(l == NULL) {
     L = luaL_newstate();
     install_janosh_functions(L, true);
@@ -764,6 +787,28 @@ std::pair<int, string> LuaScript::performRequest(janosh::Request req) {
   }
 }
 
+/**
+ * Sends a request of the open transaction without waiting for its response.
+ */
+bool LuaScript::performSubmit(janosh::Request req) {
+  std::unique_lock<std::mutex> lock(open_lock_);
+  if(!isOpen)
+    throw janosh_exception() << string_info({"Pipelined requests need an open transaction"});
+
+  return submitCallback_(req);
+}
+
+/**
+ * Receives the response of the oldest submitted request.
+ */
+std::pair<int, string> LuaScript::performCollect() {
+  std::unique_lock<std::mutex> lock(open_lock_);
+  if(!isOpen)
+    throw janosh_exception() << string_info({"Pipelined requests need an open transaction"});
+
+  return collectCallback_();
+}
+
 void LuaScript::printTransactions(std::ostream& os) {
   std::unique_lock<std::mutex> lock(open_lock_);
   for(auto& p : open_queue_) {
@@ -19,7 +19,9 @@ class LuaScript {
 public:
   LuaScript(std::function<void()> openCallback,
         std::function<std::pair<int,string>(janosh::Request&)> requestCallback,
-        std::function<void(bool)> closeCallback, lua_State* l = NULL);
+        std::function<void(bool)> closeCallback,
+        std::function<bool(janosh::Request&)> submitCallback,
+        std::function<std::pair<int,string>()> collectCallback, lua_State* l = NULL);
     ~LuaScript();
 
     void defineMacros(const std::vector<std::pair<string,string>>& macros);
@@ -32,12 +34,16 @@ public:
     void performClose(bool lockRequest, bool commit);
     void printTransactions(std::ostream& os);
     std::pair<int, string>  performRequest(janosh::Request req);
+    bool performSubmit(janosh::Request req);
+    std::pair<int, string> performCollect();
 
     static void init(std::function<void()> openCallback,
         std::function<std::pair<int,string>(janosh::Request&)> requestCallback,
-        std::function<void(bool)> closeCallback) {
+        std::function<void(bool)> closeCallback,
+        std::function<bool(janosh::Request&)> submitCallback,
+        std::function<std::pair<int,string>()> collectCallback) {
       assert(instance_ == NULL);
-      instance_ = new LuaScript(openCallback,requestCallback,closeCallback);
+      instance_ = new LuaScript(openCallback,requestCallback,closeCallback,submitCallback,collectCallback);
     }
 
 
@@ -48,6 +54,8 @@ public:
     std::function<void()> openCallback_;
     std::function<std::pair<int,string>(janosh::Request&)> requestCallback_;
     std::function<void(bool)> closeCallback_;
+    std::function<bool(janosh::Request&)> submitCallback_;
+    std::function<std::pair<int,string>()> collectCallback_;
     lua_State* L;
 private:
     static LuaScript* instance_;
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include "member_index.hpp"
+#include "record.hpp"
+#include "exception.hpp"
+
+namespace janosh {
+  std::mutex MemberIndex::mutex_;
+  map<string, MemberIndex::Entry> MemberIndex::entries_;
+  MemberIndex::LruList MemberIndex::lru_;
+  size_t MemberIndex::capacity_ = 64;
+  size_t MemberIndex::generation_ = 0;
+  std::atomic<size_t> MemberIndex::hits_(0);
+  std::atomic<size_t> MemberIndex::misses_(0);
+
+  void MemberIndex::build(const Path& dir, vector<string>& members) {
+    const string prefix = dir.basePath().key() + "/";
+    janosh::Cursor* cur = Record::getDB()->cursor();
+    string key;
+
+    try {
+      bool more = cur->jump(prefix);
+      while(more && cur->get_key(&key) && key.compare(0, prefix.size(), prefix) == 0) {
+        const size_t slash = key.find('/', prefix.size());
+        if(slash == string::npos) {
+          //leafs have no further slash. skip the descriptor of the object itself
+          if(key.compare(prefix.size(), string::npos, "!") != 0)
+            members.push_back(key);
+          more = cur->step();
+        } else {
+          //a nested directory is listed by its descriptor. '0' follows '/', so one jump skips its records
+          const string base = key.substr(0, slash);
+          members.push_back(base + "/!");
+          more = cur->jump(base + "0");
+        }
+      }
+    } catch(...) {
+      delete cur;
+      throw;
+    }
+    delete cur;
+  }
+
+  void MemberIndex::store(const string& pretty, vector<string>& members) {
+    auto it = entries_.find(pretty);
+    if(it != entries_.end()) {
+      (*it).second.members.swap(members);
+      lru_.splice(lru_.begin(), lru_, (*it).second.lru);
+      return;
+    }
+
+    if(entries_.size() >= capacity_)
+      drop(entries_.find(lru_.back()));
+
+    lru_.push_front(pretty);
+    Entry& e = entries_[pretty];
+    e.members.swap(members);
+    e.lru = lru_.begin();
+  }
+
+  map<string, MemberIndex::Entry>::iterator MemberIndex::drop(map<string, Entry>::iterator it) {
+    lru_.erase((*it).second.lru);
+    return entries_.erase(it);
+  }
+
+  /**
+   * Runs a search on the members of a directory, building its entry if it is missing or stale.
+   */
+  bool MemberIndex::lookup(const Path& dir, const size_t size, std::function<bool(const vector<string>&)> find) {
+    const string pretty = dir.pretty();
+    size_t generation;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      auto it = entries_.find(pretty);
+      if(it != entries_.end() && (*it).second.members.size() == size) {
+        ++hits_;
+        lru_.splice(lru_.begin(), lru_, (*it).second.lru);
+        return find((*it).second.members);
+      }
+      generation = generation_;
+    }
+
+    ++misses_;
+    vector<string> members;
+    build(dir, members);
+    bool found = find(members);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(capacity_ > 0 && generation == generation_)
+      store(pretty, members);
+    return found;
+  }
+
+  bool MemberIndex::member(const Path& dir, const size_t size, const size_t n, string& key) {
+    return lookup(dir, size, [&](const vector<string>& members) {
+      if(n >= members.size())
+        return false;
+      key = members[n];
+      return true;
+    });
+  }
+
+  bool MemberIndex::rank(const Path& dir, const size_t size, const string& key, size_t& n) {
+    return lookup(dir, size, [&](const vector<string>& members) {
+      //a directory "<key>/!" directly follows its base key
+      auto pos = std::lower_bound(members.begin(), members.end(), key);
+      if(pos == members.end() || (*pos != key && *pos != key + "/!"))
+        return false;
+      n = pos - members.begin();
+      return true;
+    });
+  }
+
+  void MemberIndex::added(const string& path) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++generation_;
+    if(entries_.empty())
+      return;
+
+    const Path p(path);
+    if(p.isRoot())
+      return;
+
+    auto it = entries_.find(p.parent().pretty());
+    if(it == entries_.end())
+      return;
+
+    const string key = p.key();
+    vector<string>& members = (*it).second.members;
+    auto pos = std::lower_bound(members.begin(), members.end(), key);
+    if(pos == members.end() || *pos != key)
+      members.insert(pos, key);
+  }
+
+  void MemberIndex::removed(const string& path) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++generation_;
+    if(entries_.empty())
+      return;
+
+    const Path p(path);
+    if(p.isDirectory()) {
+      //pretty paths of directories end with "."
+      const string prefix = path.substr(0, path.size() - 1);
+      auto it = entries_.lower_bound(prefix);
+      while(it != entries_.end() && (*it).first.compare(0, prefix.size(), prefix) == 0)
+        it = drop(it);
+    }
+
+    if(p.isRoot())
+      return;
+
+    auto it = entries_.find(p.parent().pretty());
+    if(it == entries_.end())
+      return;
+
+    const string key = p.key();
+    vector<string>& members = (*it).second.members;
+    auto pos = std::lower_bound(members.begin(), members.end(), key);
+    if(pos != members.end() && *pos == key)
+      members.erase(pos);
+  }
+
+  void MemberIndex::invalidateAll() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++generation_;
+    entries_.clear();
+    lru_.clear();
+  }
+
+  void MemberIndex::setCapacity(const size_t capacity) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    entries_.clear();
+    lru_.clear();
+  }
+
+  size_t MemberIndex::hits() {
+    return hits_;
+  }
+
+  size_t MemberIndex::misses() {
+    return misses_;
+  }
+}
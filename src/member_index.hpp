@@ -0,0 +1,88 @@
+#ifndef _JANOSH_MEMBER_INDEX_HPP
+#define _JANOSH_MEMBER_INDEX_HPP
+
+#include <map>
+#include <list>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include "path.hpp"
+
+namespace janosh {
+  using std::string;
+  using std::map;
+  using std::vector;
+
+  /**
+   * Keeps the keys of the direct members of objects in insertion independent, ordinal order,
+   * so the n-th member of an object can be found without stepping over its siblings and their children.
+   * Entries are keyed by the pretty path of the object and built with a cursor walk that jumps over nested subtrees.
+   * Settled writes and deletes add and remove members of existing entries in place.
+   * The least recently used entry is evicted when the capacity is reached.
+   */
+  class MemberIndex {
+    typedef std::list<string> LruList;
+
+    struct Entry {
+      vector<string> members;
+      LruList::iterator lru;
+    };
+
+    static std::mutex mutex_;
+    static map<string, Entry> entries_;
+    static LruList lru_;
+    static size_t capacity_;
+    //bumped on every change. protects against storing entries built before a write.
+    static size_t generation_;
+    static std::atomic<size_t> hits_;
+    static std::atomic<size_t> misses_;
+
+    static void build(const Path& dir, vector<string>& members);
+    static bool lookup(const Path& dir, const size_t size, std::function<bool(const vector<string>&)> find);
+    static void store(const string& pretty, vector<string>& members);
+    static map<string, Entry>::iterator drop(map<string, Entry>::iterator it);
+  public:
+    /**
+     * Looks up the key of the n-th member of an object.
+     * The entry is rebuilt when its member count doesn't match the size of the directory record.
+     * @param dir the path of the object
+     * @param size the size stored in the directory record
+     * @param n the zero based ordinal of the member
+     * @param key receives the database key of the member
+     * @return true if the member was found
+     */
+    static bool member(const Path& dir, const size_t size, const size_t n, string& key);
+
+    /**
+     * Looks up the ordinal of a member. The ordinal of an array element is its position in the array.
+     * @param dir the path of the directory
+     * @param size the size stored in the directory record
+     * @param key the database key of the member. Directories may be given without the trailing "/!"
+     * @param n receives the zero based ordinal
+     * @return true if the member was found
+     */
+    static bool rank(const Path& dir, const size_t size, const string& key, size_t& n);
+
+    /**
+     * Adds a written record to the entry of its parent object.
+     * @param path the pretty path of the record
+     */
+    static void added(const string& path);
+
+    /**
+     * Removes a deleted record from the entry of its parent object.
+     * For directories the entries of it and of all directories below it are dropped.
+     * @param path the pretty path of the record
+     */
+    static void removed(const string& path);
+    static void invalidateAll();
+
+    static void setCapacity(const size_t capacity);
+    static size_t hits();
+    static size_t misses();
+  };
+}
+
+#endif
@@ -3,8 +3,8 @@
 
 #include <string>
 #include <vector>
-#include <ktremotedb.h>
 #include "logger.hpp"
+#include "storage_backend.hpp"
 #include "component.hpp"
 
 namespace janosh {
@@ -12,8 +12,6 @@ namespace janosh {
   using std::string;
   using std::vector;
 
-  typedef kyototycoon::RemoteDB::Cursor Cursor;
-
   class Path {
     string keyStr;
     string prettyStr;
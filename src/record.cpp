@@ -2,6 +2,8 @@
 #include "exception.hpp"
 #include "tracker.hpp"
 #include "logger.hpp"
+#include "directory_cache.hpp"
+#include "value_cache.hpp"
 
 namespace janosh {
 
@@ -49,7 +51,7 @@ namespace janosh {
   }
 
   Record::Record(const Path& path) :
-    Base(Record::getDB()->cursor()),
+    Base(RecordPool::acquire()),
     pathObj(path),
     doesExist(false)
   {}
@@ -58,32 +60,95 @@ namespace janosh {
     doesExist(false){
   }
 
-  void Record::makeDB(const string& host, const int32_t& port) {
+  /**
+   * Creates the value of a record from its database representation.
+   * @param path the path of the record
+   * @param dbValue the value as stored in the database
+   * @return the value
+   */
+  Value Record::makeValue(const Path& path, const string& dbValue) {
+    if(path.isDirectory()) {
+      return Value(dbValue, true);
+    } else if(path.isWildcard()) {
+      return Value(dbValue, Value::Range);
+    } else if(!dbValue.empty()) {
+      if(dbValue.at(0) == 'n')
+        return Value(dbValue.substr(1), Value::Number);
+      if(dbValue.at(0) == 'b')
+        return Value(dbValue.substr(1), Value::Boolean);
+      if(dbValue.at(0) == 's')
+        return Value(dbValue.substr(1), Value::String);
+    }
+
+    return Value();
+  }
+
+  void Record::makeDB(const Settings& settings) {
+    std::unique_lock<std::mutex> lock(Record::dbMutex);
     auto it = Record::db.find(std::this_thread::get_id());
     if(it != Record::db.end())
       throw janosh_exception() << msg_info("DB already initialized");
-    kyototycoon::RemoteDB* rdb = new kyototycoon::RemoteDB();
-    rdb->open(host, port);
-    Record::db[std::this_thread::get_id()] = rdb;
-
+    StorageBackend* backend = StorageBackend::make(settings);
+    try {
+      backend->open();
+    } catch(...) {
+      delete backend;
+      throw;
+    }
+    Record::db[std::this_thread::get_id()] = backend;
+    Record::threadDB = backend;
+    lock.unlock();
+    RecordPool::open();
   }
-  kyototycoon::RemoteDB* Record::getDB() {
-    auto it = Record::db.find(std::this_thread::get_id());
-    if(it == Record::db.end())
+
+  StorageBackend* Record::getDB() {
+    if(Record::threadDB == NULL)
       throw janosh_exception() << msg_info("DB not initialized");
 
-    return (*it).second;
+    return Record::threadDB;
+  }
+
+  bool Record::hasDB() {
+    return Record::threadDB != NULL;
   }
 
   void Record::destroyDB() {
+    RecordPool::drain();
+    std::unique_lock<std::mutex> lock(Record::dbMutex);
     auto it = Record::db.find(std::this_thread::get_id());
     if(it == Record::db.end())
       throw janosh_exception() << msg_info("DB not initialized");
 
-    kyototycoon::RemoteDB* rdb = (*it).second;
+    StorageBackend* backend = (*it).second;
     Record::db.erase(it);
-    rdb->close();
-    delete rdb;
+    Record::threadDB = NULL;
+    backend->close();
+    delete backend;
+    lock.unlock();
+    Tracker::removeInstancePerThread();
+  }
+
+  /**
+   * Makes sure the calling thread has a working backend. Opens it if it is missing
+   * and reconnects it if it doesn't answer anymore.
+   * @return false if the backend isn't usable.
+   */
+  bool Record::checkDB(const Settings& settings) {
+    StorageBackend* backend = Record::threadDB;
+    try {
+      if(backend == NULL) {
+        Record::makeDB(settings);
+      } else if(!backend->ping()) {
+        LOG_INFO_STR("Backend connection lost. Reconnecting");
+        //pooled cursors belong to the lost connection
+        RecordPool::open();
+        backend->reconnect();
+      }
+    } catch(std::exception& ex) {
+      LOG_ERR_MSG("Backend unavailable", ex.what());
+      return false;
+    }
+    return true;
   }
 
   janosh::Cursor* Record::getCursorPtr() {
@@ -122,6 +187,8 @@ namespace janosh {
     if(!getCursorPtr()->remove())
       throw record_exception() << path_info({"failed to remove record", this->pathObj});
 
+    Tracker::getInstancePerThread()->settle(this->pathObj.pretty(), "", Tracker::DELETE);
+
     this->clear();
     readPath();
   }
@@ -135,6 +202,11 @@ namespace janosh {
     if(!isInitialized())
       throw record_exception() << path_info({"uninitialized record", this->pathObj});
 
+    if(isDirectory())
+      DirectoryCache::invalidate(this->pathObj.pretty());
+    else if(ValueCache* vc = ValueCache::getInstance())
+      vc->invalidate(this->pathObj.pretty());
+
     return getCursorPtr()->set_value_str(v);
   }
 
@@ -340,21 +412,14 @@ namespace janosh {
     if(empty())
       throw record_exception() << path_info({"no value found", this->pathObj});
 
+    ValueCache* vc = ValueCache::getInstance();
+    size_t gen = vc ? vc->generation(path().pretty()) : 0;
     string v;
     bool s = getCursorPtr()->get_value(&v);
     Tracker::getInstancePerThread()->update(path().pretty(), v, Tracker::READ);
-    if(path().isDirectory()) {
-      valueObj = Value(v, true);
-    } else if(path().isWildcard()) {
-      valueObj = Value(v, Value::Range);
-    } else {
-      if(v.at(0) == 'n')
-        valueObj = Value(v.substr(1), Value::Number);
-      if(v.at(0) == 'b')
-        valueObj = Value(v.substr(1), Value::Boolean);
-      if(v.at(0) == 's')
-        valueObj = Value(v.substr(1), Value::String);
-    }
+    valueObj = makeValue(path(), v);
+    if(s && vc && !isDirectory() && !path().isWildcard())
+      vc->put(path().pretty(), valueObj, gen);
 
     return s;
   }
@@ -379,18 +444,8 @@ namespace janosh {
      bool s = getCursorPtr()->get(&k, &v);
      pathObj = k;
      Tracker::getInstancePerThread()->update(path().pretty(), v, Tracker::READ);
-     if(path().isDirectory()) {
-       valueObj = Value(v, true);
-     } else if(path().isWildcard()) {
-       valueObj = Value(v, Value::Range);
-     } else {
-       if(v.at(0) == 'n')
-         valueObj = Value(v.substr(1), Value::Number);
-       if(v.at(0) == 'b')
-         valueObj = Value(v.substr(1), Value::Boolean);
-       if(v.at(0) == 's')
-         valueObj = Value(v.substr(1), Value::String);
-     }
+     valueObj = makeValue(path(), v);
+     //the key is only known after the step, so only readValue() feeds the value cache
      return s;
   }
 
@@ -404,6 +459,48 @@ namespace janosh {
     return *this;
   }
 
+  /**
+   * Like fetch() but directory records may be served from the directory cache
+   * and leaf records from the value cache.
+   * The cursor isn't positioned when the value comes from the cache, so the record
+   * must only be used to inspect the value afterwards.
+   * @return this record
+   */
+  Record& Record::lookup() {
+    if(!isInitialized())
+      throw record_exception() << path_info({"uninitialized record", this->pathObj});
+
+    if(hasData())
+      return *this;
+
+    if(isDirectory()) {
+      DirectoryCache* cache = DirectoryCache::getInstancePerThread();
+      const string& pretty = this->path().pretty();
+      if(cache->get(pretty, this->valueObj)) {
+        this->doesExist = true;
+        return *this;
+      }
+
+      size_t gen = cache->generation();
+      fetch();
+      if(exists())
+        cache->put(pretty, this->valueObj, gen);
+      return *this;
+    }
+
+    ValueCache* vc = ValueCache::getInstance();
+    if(vc && !this->path().isWildcard()) {
+      const string& pretty = this->path().pretty();
+      if(vc->get(pretty, this->valueObj)) {
+        this->doesExist = true;
+        Tracker::getInstancePerThread()->update(pretty, this->valueObj.str(), Tracker::READ);
+        return *this;
+      }
+    }
+
+    return fetch();
+  }
+
   bool Record::operator==(const Record& other) const {
     return this->path() == other.path();
   }
@@ -430,7 +527,59 @@ namespace janosh {
       return os;
   }
 
-  std::mutex RecordPool::mutex_;
-  std::vector<Record> RecordPool::pool_;
+  thread_local RecordPool::FreeList RecordPool::free_ = {0, {}};
+  std::atomic<size_t> RecordPool::generation_(0);
+  std::atomic<size_t> RecordPool::hits_(0);
+  std::atomic<size_t> RecordPool::misses_(0);
+
+  Record::Base RecordPool::acquire() {
+    std::thread::id tid = std::this_thread::get_id();
+    const size_t generation = free_.generation;
+    janosh::Cursor* cur = NULL;
+
+    if(!free_.cursors.empty()) {
+      ++hits_;
+      cur = free_.cursors.back();
+      free_.cursors.pop_back();
+    } else {
+      ++misses_;
+      cur = Record::getDB()->cursor();
+    }
+
+    return Record::Base(cur, [=](janosh::Cursor* c) {
+      RecordPool::release(c, tid, generation);
+    });
+  }
+
+  void RecordPool::release(janosh::Cursor* cur, const std::thread::id& tid, const size_t generation) {
+    //only keep cursors of the backend that is still alive. records dropped by another thread can't reach its free list.
+    if(tid == std::this_thread::get_id() && free_.generation == generation && free_.cursors.size() < MAX_FREE_CURSORS) {
+      free_.cursors.push_back(cur);
+      return;
+    }
+    delete cur;
+  }
+
+  void RecordPool::open() {
+    for(janosh::Cursor* cur : free_.cursors)
+      delete cur;
+    free_.cursors.clear();
+    free_.generation = ++generation_;
+  }
+
+  void RecordPool::drain() {
+    for(janosh::Cursor* cur : free_.cursors)
+      delete cur;
+    free_.cursors.clear();
+    free_.generation = 0;
+  }
+
+  size_t RecordPool::hits() {
+    return hits_;
+  }
+
+  size_t RecordPool::misses() {
+    return misses_;
+  }
 }
 
@@ -6,6 +6,9 @@
 #include <iostream>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <map>
+#include <vector>
 
 #include "path.hpp"
 #include "value.hpp"
@@ -20,7 +23,10 @@ namespace janosh {
     Value valueObj;
     bool doesExist;
     void init(Path path);
-    static std::map<std::thread::id, kyototycoon::RemoteDB*> db;
+    static std::map<std::thread::id, StorageBackend*> db;
+    static std::mutex dbMutex;
+    //the backend of the calling thread. the map above only guards creation and teardown.
+    static thread_local StorageBackend* threadDB;
     //exact copy referring to the same Cursor*
     Record(const Path& path);
     janosh::Cursor* getCursorPtr();
@@ -31,9 +37,12 @@ namespace janosh {
     Record(const Record& other);
     Record clone();
 
-    static void makeDB(const string& host, const int32_t& port);
-    static kyototycoon::RemoteDB* getDB();
+    static Value makeValue(const Path& path, const string& dbValue);
+    static void makeDB(const Settings& settings);
+    static StorageBackend* getDB();
+    static bool hasDB();
     static void destroyDB();
+    static bool checkDB(const Settings& settings);
 
     const Value::Type getType()  const;
     const size_t getSize() const;
@@ -71,6 +80,7 @@ namespace janosh {
     const bool empty() const;
 
     Record& fetch();
+    Record& lookup();
     bool readValue();
     bool readPath();
     bool read();
@@ -84,31 +94,48 @@ namespace janosh {
   std::ostream& operator<< (std::ostream& os, const janosh::Value& v);
   std::ostream& operator<< (std::ostream& os, const janosh::Record& r);
 
+  /**
+   * Recycles the cursors of released records per thread instead of
+   * creating (and with the remote backend opening) a new one for every record.
+   */
   class RecordPool {
-    static std::mutex mutex_;
-    static std::vector<Record> pool_;
+    struct FreeList {
+      size_t generation;
+      std::vector<janosh::Cursor*> cursors;
+    };
+
+    //the free list of the calling thread. only cursors of its current backend are kept.
+    static thread_local FreeList free_;
+    static std::atomic<size_t> generation_;
+    static std::atomic<size_t> hits_;
+    static std::atomic<size_t> misses_;
+
+    static void release(janosh::Cursor* cur, const std::thread::id& tid, const size_t generation);
 public:
+    static const size_t MAX_FREE_CURSORS = 64;
+
     static Record get(const string& path) {
-      //std::unique_lock<std::mutex>(mutex_);
       return Record(path);
-      //FIXME pool records;
-//      if(pool_.empty()) {
-//        Record r(path);
-//        pool_.push_back(r);
-//        return r;
-//      } else {
-//        for(auto& r : pool_) {
-//          if(static_cast<Record::Base*>(&r)->use_count() == 1) {
-//            r.setPath(path);
-//            return r;
-//          }
-//        }
-//
-//        Record r(path);
-//        pool_.push_back(r);
-//        return r;
-//      }
     }
+
+    /**
+     * Takes a cursor from the free list of the calling thread or creates a new one.
+     * @return A cursor that is put back into the pool when the last reference is dropped.
+     */
+    static Record::Base acquire();
+
+    /**
+     * Starts pooling for the calling thread. Called whenever a backend is created.
+     */
+    static void open();
+
+    /**
+     * Deletes all pooled cursors of the calling thread. Must be called before its backend is destroyed.
+     */
+    static void drain();
+
+    static size_t hits();
+    static size_t misses();
   };
 }
 #endif
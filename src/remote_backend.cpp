@@ -0,0 +1,143 @@
+#include <algorithm>
+#include "remote_backend.hpp"
+#include "exception.hpp"
+
+namespace janosh {
+
+  RemoteCursor::RemoteCursor(kyototycoon::RemoteDB::Cursor* cur) : cur_(cur) {
+  }
+
+  RemoteCursor::~RemoteCursor() {
+    delete cur_;
+  }
+
+  bool RemoteCursor::jump() {
+    return cur_->jump();
+  }
+
+  bool RemoteCursor::jump(const string& key) {
+    return cur_->jump(key);
+  }
+
+  bool RemoteCursor::jump_back(const string& key) {
+    return cur_->jump_back(key);
+  }
+
+  bool RemoteCursor::step() {
+    return cur_->step();
+  }
+
+  bool RemoteCursor::step_back() {
+    return cur_->step_back();
+  }
+
+  bool RemoteCursor::set_value_str(const string& value) {
+    return cur_->set_value_str(value);
+  }
+
+  bool RemoteCursor::remove() {
+    return cur_->remove();
+  }
+
+  bool RemoteCursor::get_key(string* key, bool step) {
+    return cur_->get_key(key, step);
+  }
+
+  bool RemoteCursor::get_value(string* value, bool step) {
+    return cur_->get_value(value, step);
+  }
+
+  bool RemoteCursor::get(string* key, string* value, bool step) {
+    return cur_->get(key, value, NULL, step);
+  }
+
+  RemoteBackend::RemoteBackend(const string& host, const int32_t& port) :
+      host_(host), port_(port) {
+  }
+
+  RemoteBackend::~RemoteBackend() {
+  }
+
+  void RemoteBackend::open() {
+    if(!db_.open(host_, port_))
+      throw db_exception() << string_info({"Unable to connect to kyototycoon", host_ + ":" + std::to_string(port_), db_.error().name()});
+  }
+
+  void RemoteBackend::close() {
+    db_.close();
+  }
+
+  StorageCursor* RemoteBackend::cursor() {
+    return new RemoteCursor(db_.cursor());
+  }
+
+  bool RemoteBackend::set(const string& key, const string& value) {
+    return db_.set(key, value);
+  }
+
+  bool RemoteBackend::add(const string& key, const string& value) {
+    return db_.add(key, value);
+  }
+
+  bool RemoteBackend::replace(const string& key, const string& value) {
+    return db_.replace(key, value);
+  }
+
+  bool RemoteBackend::remove(const string& key) {
+    return db_.remove(key);
+  }
+
+  bool RemoteBackend::get(const string& key, string* value) {
+    return db_.get(key, value);
+  }
+
+  bool RemoteBackend::clear() {
+    return db_.clear();
+  }
+
+  int64_t RemoteBackend::set_bulk(const std::map<string, string>& recs) {
+    return db_.set_bulk(recs);
+  }
+
+  int64_t RemoteBackend::remove_bulk(const std::vector<string>& keys) {
+    return db_.remove_bulk(keys);
+  }
+
+  int64_t RemoteBackend::get_bulk(const std::vector<string>& keys, std::map<string, string>* recs) {
+    return db_.get_bulk(keys, recs);
+  }
+
+  int64_t RemoteBackend::match_prefix(const string& prefix, std::vector<string>* keys) {
+    return db_.match_prefix(prefix, keys);
+  }
+
+  /**
+   * kyototycoon can't list a key range, and its cursors take one request per step.
+   * The keys are listed with bounded prefix matches instead, which return the matching keys in key order,
+   * and the keys below start are dropped. The limit grows until it reaches past the keys below start.
+   */
+  int64_t RemoteBackend::list_keys(const string& prefix, const string& start, const size_t max, std::vector<string>* keys) {
+    int64_t limit = max;
+    for(;;) {
+      std::vector<string> matched;
+      int64_t n = db_.match_prefix(prefix, &matched, limit);
+      if(n < 0)
+        return -1;
+
+      auto first = std::lower_bound(matched.begin(), matched.end(), start);
+      const int64_t below = first - matched.begin();
+      if(matched.end() - first >= static_cast<int64_t>(max) || n < limit) {
+        auto last = first + std::min<int64_t>(matched.end() - first, max);
+        keys->insert(keys->end(), first, last);
+        return last - first;
+      }
+
+      limit = std::max(limit * 2, below + static_cast<int64_t>(max));
+    }
+  }
+
+  bool RemoteBackend::ping() {
+    std::map<string, string> status;
+    return db_.status(&status);
+  }
+}
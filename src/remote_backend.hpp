@@ -0,0 +1,58 @@
+#ifndef _JANOSH_REMOTE_BACKEND_HPP
+#define _JANOSH_REMOTE_BACKEND_HPP
+
+#include <ktremotedb.h>
+#include "storage_backend.hpp"
+
+namespace janosh {
+
+  class RemoteCursor : public StorageCursor {
+    kyototycoon::RemoteDB::Cursor* cur_;
+  public:
+    explicit RemoteCursor(kyototycoon::RemoteDB::Cursor* cur);
+    virtual ~RemoteCursor();
+
+    virtual bool jump() override;
+    virtual bool jump(const string& key) override;
+    virtual bool jump_back(const string& key) override;
+    virtual bool step() override;
+    virtual bool step_back() override;
+    virtual bool set_value_str(const string& value) override;
+    virtual bool remove() override;
+    virtual bool get_key(string* key, bool step = false) override;
+    virtual bool get_value(string* value, bool step = false) override;
+    virtual bool get(string* key, string* value, bool step = false) override;
+  };
+
+  /**
+   * Talks to a kyototycoon server. One connection per instance.
+   */
+  class RemoteBackend : public StorageBackend {
+    kyototycoon::RemoteDB db_;
+    string host_;
+    int32_t port_;
+  public:
+    RemoteBackend(const string& host, const int32_t& port);
+    virtual ~RemoteBackend();
+
+    virtual void open() override;
+    virtual void close() override;
+    virtual StorageCursor* cursor() override;
+
+    virtual bool set(const string& key, const string& value) override;
+    virtual bool add(const string& key, const string& value) override;
+    virtual bool replace(const string& key, const string& value) override;
+    virtual bool remove(const string& key) override;
+    virtual bool get(const string& key, string* value) override;
+    virtual bool clear() override;
+
+    virtual int64_t set_bulk(const std::map<string, string>& recs) override;
+    virtual int64_t remove_bulk(const std::vector<string>& keys) override;
+    virtual int64_t get_bulk(const std::vector<string>& keys, std::map<string, string>* recs) override;
+    virtual int64_t match_prefix(const string& prefix, std::vector<string>* keys) override;
+    virtual int64_t list_keys(const string& prefix, const string& start, const size_t max, std::vector<string>* keys) override;
+    virtual bool ping() override;
+  };
+}
+
+#endif
@@ -6,17 +6,201 @@
  */
 
 #include "request.hpp"
+#include "exception.hpp"
+#include <cstring>
+#include <streambuf>
 
 namespace janosh {
 
+/*
+ * The flat request format. All integers are in host byte order like the frame lengths.
+ *
+ *  0  'J' 'R' 'Q' version
+ *  4  uint8 format, uint8 flags, uint16 command id
+ *  8  int32 pid, uint32 number of arguments
+ * 16  uint64 sequence number (since version 2)
+ * 24  the command name if the command id is 0, the cmdline and the info string
+ *     followed by the arguments as uint8 type and string.
+ *
+ * Strings are prefixed by their uint32 length.
+ */
+static const char REQUEST_MAGIC[3] = { 'J', 'R', 'Q' };
+static const uint8_t REQUEST_VERSION = 2;
+static const size_t REQUEST_MIN_SIZE = 16;
+static const uint8_t FLAG_TRIGGERS = 1;
+static const uint8_t FLAG_VERBOSE = 2;
+
+//command ids are part of the wire format. only append to this list.
+static const char* const COMMANDS[] = {
+  "", "load", "import", "set", "add", "replace", "append", "dump", "size", "get", "copy", "remove",
+  "shift", "move", "truncate", "mkarr", "mkobj", "hash", "publish", "exists", "random", "filter",
+  "patch", "migrate", "stats", "query", "buildindex", "trigger", "batch", "setraw"
+};
+static const size_t NUM_COMMANDS = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+/**
+ * A read only stream buffer on top of a receive buffer.
+ */
+class MemoryBuf : public std::streambuf {
+public:
+  MemoryBuf(const char* data, const size_t len) {
+    char* p = const_cast<char*>(data);
+    setg(p, p, p + len);
+  }
+};
+
+/**
+ * Reads fields of the flat request format from a buffer and checks its bounds.
+ */
+class FlatReader {
+  const char* pos_;
+  const char* end_;
+
+  void require(const size_t n) {
+    if(size_t(end_ - pos_) < n)
+      throw janosh_exception() << msg_info("truncated request");
+  }
+public:
+  FlatReader(const char* data, const size_t len) : pos_(data), end_(data + len) {
+  }
+
+  template<typename T> T read() {
+    T v;
+    require(sizeof(T));
+    std::memcpy(&v, pos_, sizeof(T));
+    pos_ += sizeof(T);
+    return v;
+  }
+
+  void readString(string& s) {
+    uint32_t len = read<uint32_t>();
+    require(len);
+    s.assign(pos_, len);
+    pos_ += len;
+  }
+};
+
+template<typename T> static void append(string& buf, const T& v) {
+  buf.append((const char*) &v, sizeof(T));
+}
+
+static void appendString(string& buf, const string& s) {
+  append(buf, uint32_t(s.size()));
+  buf.append(s);
+}
+
+static bool isScalar(const Value::Type& t) {
+  return t == Value::String || t == Value::Number || t == Value::Boolean;
+}
+
+static bool isFlat(const char* data, const size_t len) {
+  return len >= REQUEST_MIN_SIZE && std::memcmp(data, REQUEST_MAGIC, sizeof(REQUEST_MAGIC)) == 0;
+}
+
+static void read_flat_request(Request& req, const char* data, const size_t len) {
+  FlatReader reader(data + sizeof(REQUEST_MAGIC), len - sizeof(REQUEST_MAGIC));
+  uint8_t version = reader.read<uint8_t>();
+  if(version < 1 || version > REQUEST_VERSION)
+    throw janosh_exception() << string_info({"unsupported request version", std::to_string(version)});
+
+  uint8_t format = reader.read<uint8_t>();
+  if(format > Raw)
+    throw janosh_exception() << string_info({"invalid request format", std::to_string(format)});
+  req.format_ = Format(format);
+  uint8_t flags = reader.read<uint8_t>();
+  req.runTriggers_ = flags & FLAG_TRIGGERS;
+  req.verbose_ = flags & FLAG_VERBOSE;
+  uint16_t id = reader.read<uint16_t>();
+  req.pinfo_.pid_ = reader.read<int32_t>();
+  uint32_t argc = reader.read<uint32_t>();
+  req.seq_ = version >= 2 ? reader.read<uint64_t>() : 0;
+
+  if(id == 0)
+    reader.readString(req.command_);
+  else if(id < NUM_COMMANDS)
+    req.command_ = COMMANDS[id];
+  else
+    throw janosh_exception() << string_info({"unknown command id", std::to_string(id)});
+
+  reader.readString(req.pinfo_.cmdline_);
+  reader.readString(req.info_);
+
+  req.vecArgs_.clear();
+  req.vecArgs_.reserve(argc);
+  string arg;
+  for(uint32_t i = 0; i < argc; ++i) {
+    uint8_t type = reader.read<uint8_t>();
+    if(!isScalar(Value::Type(type)))
+      throw janosh_exception() << string_info({"invalid argument type", std::to_string(type)});
+    reader.readString(arg);
+    req.vecArgs_.push_back(Value(arg, Value::Type(type)));
+  }
+}
+
+void read_request(Request& req, const char* data, const size_t len) {
+  if(isFlat(data, len)) {
+    read_flat_request(req, data, len);
+  } else {
+    MemoryBuf buf(data, len);
+    istream is(&buf);
+    read_request(req, is);
+  }
+}
+
+uint64_t read_request_seq(const char* data, const size_t len) {
+  if(!isFlat(data, len) || len < REQUEST_HEADER_SIZE || uint8_t(data[sizeof(REQUEST_MAGIC)]) < 2)
+    return 0;
+
+  uint64_t seq;
+  std::memcpy(&seq, data + REQUEST_HEADER_SIZE - sizeof(seq), sizeof(seq));
+  return seq;
+}
+
 void read_request(Request& req, istream& is) {
   boost::archive::binary_iarchive ia(is);
   ia >> req;
 }
 
+void write_request(const Request& req, string& buf) {
+  //archives can't carry the sequence number a pipelined connection depends on
+  for(const Value& arg : req.vecArgs_) {
+    if(!isScalar(arg.getType()))
+      throw janosh_exception() << string_info({"only scalar arguments can be sent", req.command_});
+  }
+
+  uint16_t id = 0;
+  for(size_t i = 1; i < NUM_COMMANDS; ++i) {
+    if(req.command_ == COMMANDS[i]) {
+      id = i;
+      break;
+    }
+  }
+
+  buf.clear();
+  buf.append(REQUEST_MAGIC, sizeof(REQUEST_MAGIC));
+  append(buf, REQUEST_VERSION);
+  append(buf, uint8_t(req.format_));
+  append(buf, uint8_t((req.runTriggers_ ? FLAG_TRIGGERS : 0) | (req.verbose_ ? FLAG_VERBOSE : 0)));
+  append(buf, id);
+  append(buf, int32_t(req.pinfo_.pid_));
+  append(buf, uint32_t(req.vecArgs_.size()));
+  append(buf, req.seq_);
+
+  if(id == 0)
+    appendString(buf, req.command_);
+  appendString(buf, req.pinfo_.cmdline_);
+  appendString(buf, req.info_);
+
+  for(const Value& arg : req.vecArgs_) {
+    append(buf, uint8_t(arg.getType()));
+    appendString(buf, arg.str());
+  }
+}
+
 void write_request(Request& req, ostream& os) {
-  boost::archive::binary_oarchive oa(os);
-  oa << req;
+  string buf;
+  write_request(req, buf);
+  os.write(buf.data(), buf.size());
 }
 
 } /* namespace janosh */
@@ -35,6 +35,8 @@ public:
   bool verbose_ = false;
   ProcessInfo pinfo_;
   string info_;
+  //tags the response of the request on a pipelined connection. not part of archives.
+  uint64_t seq_ = 0;
 
   Request() {
   }
@@ -57,6 +59,7 @@ public:
     this->verbose_ = other.verbose_;
     this->pinfo_ = other.pinfo_;
     this->info_ = other.info_;
+    this->seq_ = other.seq_;
   }
   virtual ~Request() {}
 
@@ -72,7 +75,29 @@ public:
   }
 };
 
+/**
+ * Decodes a request in place from a receive buffer.
+ * Accepts the flat request format as well as boost serialization archives of older clients.
+ */
+void read_request(Request& req, const char* data, const size_t len);
 void read_request(Request& req, istream& is);
+
+/**
+ * The number of leading bytes of a request read_request_seq needs.
+ */
+const size_t REQUEST_HEADER_SIZE = 24;
+
+/**
+ * Reads the sequence number of a request without decoding it, e.g. to answer a request that is rejected.
+ * @return the sequence number or 0 if the request doesn't carry one.
+ */
+uint64_t read_request_seq(const char* data, const size_t len);
+
+/**
+ * Encodes a request in the flat request format.
+ * Only string, number and boolean arguments can be encoded. Other arguments throw a janosh_exception.
+ */
+void write_request(const Request& req, string& buf);
 void write_request(Request& req, ostream& os);
 
 } /* namespace janosh */
@@ -0,0 +1,50 @@
+#include <algorithm>
+#include <map>
+#include "scan_iterator.hpp"
+#include "exception.hpp"
+
+namespace janosh {
+
+  ScanIterator::ScanIterator(StorageBackend* backend, const string& prefix, const string& start, const size_t chunkSize) :
+      backend_(backend),
+      prefix_(prefix),
+      start_(std::max(prefix, start)),
+      chunkSize_(chunkSize > 0 ? chunkSize : 1),
+      exhausted_(false) {
+  }
+
+  bool ScanIterator::fill() {
+    while(buffer_.empty() && !exhausted_) {
+      std::vector<string> chunk;
+      if(backend_->list_keys(prefix_, start_, chunkSize_, &chunk) < 0)
+        throw db_exception() << string_info({"listing keys failed", start_});
+
+      exhausted_ = chunk.size() < chunkSize_;
+      if(chunk.empty())
+        break;
+
+      //the smallest key after the last one listed
+      start_ = chunk.back() + '\0';
+
+      std::map<string, string> recs;
+      if(backend_->get_bulk(chunk, &recs) < 0)
+        throw db_exception() << string_info({"bulk read failed", chunk.front()});
+
+      //records removed since the keys were listed are skipped
+      for(auto& p : recs)
+        buffer_.push_back(p);
+    }
+
+    return !buffer_.empty();
+  }
+
+  bool ScanIterator::next(string& key, string& value) {
+    if(!fill())
+      return false;
+
+    key = buffer_.front().first;
+    value = buffer_.front().second;
+    buffer_.pop_front();
+    return true;
+  }
+}
@@ -0,0 +1,45 @@
+#ifndef _JANOSH_SCAN_ITERATOR_HPP
+#define _JANOSH_SCAN_ITERATOR_HPP
+
+#include <deque>
+#include <vector>
+#include <string>
+#include "storage_backend.hpp"
+
+namespace janosh {
+  using std::string;
+
+  /**
+   * Iterates over all records of a key prefix in key order.
+   * The keys are listed page by page with one bounded request per chunkSize keys, each page resuming
+   * after the last key of the previous one, and the values of each page are prefetched with one bulk read
+   * instead of a cursor step and get per record.
+   */
+  class ScanIterator {
+    StorageBackend* backend_;
+    string prefix_;
+    string start_;
+    std::deque<std::pair<string, string>> buffer_;
+    size_t chunkSize_;
+    bool exhausted_;
+
+    bool fill();
+  public:
+    /**
+     * @param backend the backend to scan
+     * @param prefix the key prefix to scan
+     * @param start keys below start are skipped
+     * @param chunkSize number of records fetched per bulk read
+     */
+    ScanIterator(StorageBackend* backend, const string& prefix, const string& start, const size_t chunkSize);
+    ScanIterator(const ScanIterator& other) = delete;
+
+    /**
+     * Fetches the next record.
+     * @return false if the scan is exhausted.
+     */
+    bool next(string& key, string& value);
+  };
+}
+
+#endif
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <functional>
+#include <boost/algorithm/string.hpp>
+#include "secondary_index.hpp"
+#include "scan_iterator.hpp"
+#include "record.hpp"
+#include "exception.hpp"
+
+namespace janosh {
+  vector<SecondaryIndex::Definition> SecondaryIndex::definitions_;
+  std::mutex SecondaryIndex::locks_[SecondaryIndex::LOCK_STRIPES];
+
+  void SecondaryIndex::define(const vector<string>& patterns) {
+    definitions_.clear();
+    for(const string& p : patterns) {
+      Definition def;
+      def.pattern = boost::trim_copy(p);
+      if(def.pattern.empty())
+        continue;
+
+      boost::split(def.components, def.pattern, boost::is_any_of("/"));
+      auto it = std::find(def.components.begin(), def.components.end(), "*");
+      if(def.pattern.at(0) != '/' || it == def.components.end() || std::count(def.components.begin(), def.components.end(), "*") != 1 || it + 1 == def.components.end())
+        throw config_exception() << string_info({"invalid index pattern", def.pattern});
+
+      def.wildcard = it - def.components.begin();
+      def.base = def.pattern.substr(0, def.pattern.find('*'));
+      definitions_.push_back(def);
+    }
+  }
+
+  const SecondaryIndex::Definition& SecondaryIndex::find(const string& pattern) {
+    for(const Definition& def : definitions_) {
+      if(def.pattern == pattern)
+        return def;
+    }
+    throw janosh_exception() << string_info({"no such index", pattern});
+  }
+
+  bool SecondaryIndex::match(const Definition& def, const string& path, string& element) {
+    if(path.compare(0, def.base.size(), def.base) != 0)
+      return false;
+
+    vector<string> components;
+    boost::split(components, path, boost::is_any_of("/"));
+    if(components.size() != def.components.size())
+      return false;
+
+    for(size_t i = 0; i < components.size(); ++i) {
+      if(i != def.wildcard && components[i] != def.components[i])
+        return false;
+    }
+
+    element = def.base + components[def.wildcard];
+    return true;
+  }
+
+  string SecondaryIndex::forwardKey(const Definition& def, const string& element) {
+    return "~" + def.pattern + "\x1e" + element;
+  }
+
+  string SecondaryIndex::reverseKey(const Definition& def, const string& value, const string& element) {
+    return "~" + def.pattern + "\x1d" + value + "\x1f" + element;
+  }
+
+  /**
+   * Encodes a number so that the lexical order of the encodings equals the numeric order.
+   * The bits of the double are flipped like in a sign-magnitude to offset binary conversion and printed as hex.
+   * @param s the number as a string
+   * @param encoded the encoded number
+   * @return false if s isn't a number
+   */
+  bool SecondaryIndex::encodeNumber(const string& s, string& encoded) {
+    static const char* digits = "0123456789abcdef";
+    if(s.empty() || std::isspace(s.front()))
+      return false;
+
+    char* end;
+    double d = std::strtod(s.c_str(), &end);
+    if(end != s.c_str() + s.size() || std::isnan(d))
+      return false;
+
+    //-0 and 0 are equal
+    if(d == 0)
+      d = 0;
+
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    bits = (bits & 0x8000000000000000ULL) ? ~bits : (bits | 0x8000000000000000ULL);
+
+    encoded.resize(16);
+    for(size_t i = 16; i > 0; --i) {
+      encoded[i - 1] = digits[bits & 0xf];
+      bits >>= 4;
+    }
+    return true;
+  }
+
+  /**
+   * @param dbValue a value in database format
+   * @return the indexed form of the value or an empty string if the value isn't indexed (e.g. null)
+   */
+  string SecondaryIndex::encodeValue(const string& dbValue) {
+    if(dbValue.empty())
+      return "";
+
+    string encoded;
+    if(dbValue.front() == 'n' && encodeNumber(dbValue.substr(1), encoded))
+      return "n" + encoded;
+    else if(dbValue.front() == 'n')
+      return "s" + dbValue.substr(1);
+
+    return dbValue;
+  }
+
+  void SecondaryIndex::reconcile(const Definition& def, const string& path, const string& element) {
+    StorageBackend* db = Record::getDB();
+    const string fwd = forwardKey(def, element);
+    std::unique_lock<std::mutex> lock(locks_[std::hash<string>()(fwd) % LOCK_STRIPES]);
+
+    string dbValue;
+    string value;
+    string old;
+    if(db->get(Path(path).key(), &dbValue))
+      value = encodeValue(dbValue);
+
+    const bool indexed = db->get(fwd, &old);
+    if(indexed && old == value)
+      return;
+
+    if(indexed)
+      db->remove(reverseKey(def, old, element));
+
+    if(value.empty()) {
+      if(indexed)
+        db->remove(fwd);
+    } else if(!db->set(fwd, value) || !db->set(reverseKey(def, value, element), "")) {
+      throw db_exception() << string_info({"failed to update index", def.pattern, element});
+    }
+  }
+
+  void SecondaryIndex::update(const string& path) {
+    if(definitions_.empty() || path.empty() || path.back() == '.')
+      return;
+
+    string element;
+    for(const Definition& def : definitions_) {
+      if(match(def, path, element))
+        reconcile(def, path, element);
+    }
+  }
+
+  size_t SecondaryIndex::query(const string& pattern, const string& from, const string& to, vector<string>& elements) {
+    const Definition& def = find(pattern);
+    const string prefix = "~" + def.pattern + "\x1d";
+    vector<std::pair<string, string>> ranges;
+    string lower;
+    string upper;
+
+    if(encodeNumber(from, lower) && encodeNumber(to, upper)) {
+      ranges.push_back({"n" + lower, "n" + upper});
+    } else {
+      ranges.push_back({"s" + from, "s" + to});
+      ranges.push_back({"b" + from, "b" + to});
+    }
+
+    janosh::Cursor* cur = Record::getDB()->cursor();
+    size_t cnt = 0;
+    string key;
+
+    for(const auto& range : ranges) {
+      if(!cur->jump(prefix + range.first))
+        continue;
+
+      while(cur->get_key(&key, true)) {
+        if(key.compare(0, prefix.size(), prefix) != 0)
+          break;
+
+        size_t sep = key.rfind('\x1f');
+        if(sep == string::npos || sep < prefix.size())
+          continue;
+
+        if(key.compare(prefix.size(), sep - prefix.size(), range.second) > 0)
+          break;
+
+        elements.push_back(key.substr(sep + 1));
+        ++cnt;
+      }
+    }
+    delete cur;
+    return cnt;
+  }
+
+  size_t SecondaryIndex::rebuild(const string& pattern, const size_t chunkSize) {
+    const Definition& def = find(pattern);
+    StorageBackend* db = Record::getDB();
+    vector<string> stale;
+    for(const char* sep : { "\x1e", "\x1d" }) {
+      stale.clear();
+      if(db->match_prefix("~" + def.pattern + sep, &stale) < 0 || (!stale.empty() && db->remove_bulk(stale) < 0))
+        throw db_exception() << string_info({"failed to drop index", def.pattern});
+    }
+
+    const string prefix = Path(def.base + ".").basePath().key() + "/";
+    ScanIterator scan(db, prefix, prefix, chunkSize);
+    string key;
+    string dbValue;
+    string element;
+    size_t cnt = 0;
+
+    while(scan.next(key, dbValue)) {
+      const string path = Path(key).pretty();
+      if(match(def, path, element)) {
+        reconcile(def, path, element);
+        ++cnt;
+      }
+    }
+    return cnt;
+  }
+}
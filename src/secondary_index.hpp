@@ -0,0 +1,74 @@
+#ifndef _JANOSH_SECONDARY_INDEX_HPP
+#define _JANOSH_SECONDARY_INDEX_HPP
+
+#include <string>
+#include <vector>
+#include <mutex>
+
+namespace janosh {
+  using std::string;
+  using std::vector;
+
+  /**
+   * Declarative secondary indexes over leaf values. A pattern like "/lb/users/<*>/gender" (written without the brackets)
+   * indexes the gender of every member of /lb/users.
+   * Entries are stored next to the data under keys starting with "~", which sort after all records:
+   *   "~<pattern>\x1e<element>"               -> the indexed value of the element
+   *   "~<pattern>\x1d<value>\x1f<element>"    -> ""
+   * The first key is needed to drop the old entry on updates, the second one is scanned by queries.
+   * Indexed values keep the type prefix of the database value. Numbers are encoded so that their
+   * lexical order equals their numeric order, strings and booleans are stored as they are.
+   */
+  class SecondaryIndex {
+    struct Definition {
+      string pattern;
+      //the pretty path up to the wildcard, e.g. "/lb/users/"
+      string base;
+      vector<string> components;
+      size_t wildcard;
+    };
+
+    static const size_t LOCK_STRIPES = 64;
+    static vector<Definition> definitions_;
+    //serializes the updates of an element. elements are assigned to a stripe by the hash of their forward key.
+    static std::mutex locks_[LOCK_STRIPES];
+
+    static bool match(const Definition& def, const string& path, string& element);
+    static const Definition& find(const string& pattern);
+    static string forwardKey(const Definition& def, const string& element);
+    static string reverseKey(const Definition& def, const string& value, const string& element);
+    static string encodeValue(const string& dbValue);
+    static bool encodeNumber(const string& s, string& encoded);
+    static void reconcile(const Definition& def, const string& path, const string& element);
+  public:
+    /**
+     * Defines the indexes to maintain.
+     * @param patterns pretty paths with exactly one "*" component naming the indexed elements.
+     */
+    static void define(const vector<string>& patterns);
+
+    /**
+     * Updates the indexes covering a leaf record. Called after every write and delete reached the backend.
+     * The entries are made to match the value the record holds once the lock of the element is taken,
+     * so concurrent writes to the same record leave the entries of the last value.
+     * @param path the pretty path of the record
+     */
+    static void update(const string& path);
+
+    /**
+     * Looks up the elements whose indexed value lies within [from, to].
+     * If both bounds are numbers the numeric values are matched in numeric order,
+     * otherwise the string and boolean values in lexical order.
+     * @return the number of matching elements
+     */
+    static size_t query(const string& pattern, const string& from, const string& to, vector<string>& elements);
+
+    /**
+     * Drops and recreates the entries of an index from the records it covers.
+     * @return the number of indexed elements
+     */
+    static size_t rebuild(const string& pattern, const size_t chunkSize);
+  };
+}
+
+#endif
@@ -7,13 +7,32 @@
 
 #include "settings.hpp"
 #include <fstream>
+#include <boost/algorithm/string.hpp>
 #include <exception>
 
 
 namespace janosh {
 using std::ifstream;
 using std::exception;
-Settings::Settings() {
+Settings::Settings() :
+    maxThreads(0),
+    backend("remote"),
+    embeddedDb("+"),
+    remoteHost("127.0.0.1"),
+    remotePort(8102),
+    bulkBatchSize(1000),
+    importThreads(0),
+    scanChunkSize(1000),
+    responseChunkSize(65536),
+    directoryCacheScope("request"),
+    valueCacheCapacity(0),
+    valueCacheShards(16),
+    memberIndexCapacity(64),
+    jsonPathCacheSize(256),
+    fetchThreads(4),
+    healthCheckInterval(1000),
+    connectionBufferSize(67108864),
+    sendTimeout(10000) {
    const char* home = getenv ("HOME");
    if (home==NULL) {
      error("Can't find environment variable.", "HOME");
@@ -61,6 +80,84 @@ Settings::Settings() {
        if(find(jObj, "connectUrl", v)) {
             this->connectUrl = v.get_str();
        }
+
+       if(find(jObj, "backend", v)) {
+            this->backend = v.get_str();
+       }
+
+       if(find(jObj, "embeddedDb", v)) {
+            this->embeddedDb = v.get_str();
+       }
+
+       if(find(jObj, "remoteHost", v)) {
+            this->remoteHost = v.get_str();
+       }
+
+       if(find(jObj, "remotePort", v)) {
+            this->remotePort = std::stoi(v.get_str());
+       }
+
+       if(find(jObj, "bulkBatchSize", v)) {
+            this->bulkBatchSize = std::stoul(v.get_str());
+       }
+
+       if(find(jObj, "importThreads", v)) {
+            this->importThreads = std::stoul(v.get_str());
+       } else {
+            this->importThreads = this->maxThreads;
+       }
+
+       if(find(jObj, "scanChunkSize", v)) {
+            this->scanChunkSize = std::stoul(v.get_str());
+       }
+
+       if(find(jObj, "responseChunkSize", v)) {
+            this->responseChunkSize = std::stoul(v.get_str());
+       }
+
+       if(find(jObj, "directoryCacheScope", v)) {
+            this->directoryCacheScope = v.get_str();
+       }
+
+       if(find(jObj, "valueCacheCapacity", v)) {
+            this->valueCacheCapacity = std::stoul(v.get_str());
+       }
+
+       if(find(jObj, "valueCacheShards", v)) {
+            this->valueCacheShards = std::stoul(v.get_str());
+       }
+
+       if(find(jObj, "memberIndexCapacity", v)) {
+            this->memberIndexCapacity = std::stoul(v.get_str());
+       }
+
+       if(find(jObj, "jsonPathCacheSize", v)) {
+            this->jsonPathCacheSize = std::stoul(v.get_str());
+       }
+
+       if(find(jObj, "fetchThreads", v)) {
+            this->fetchThreads = std::stoul(v.get_str());
+       }
+
+       if(find(jObj, "healthCheckInterval", v)) {
+            this->healthCheckInterval = std::stoul(v.get_str());
+       }
+
+       if(find(jObj, "connectionBufferSize", v)) {
+            this->connectionBufferSize = std::stoul(v.get_str());
+       }
+
+       if(find(jObj, "sendTimeout", v)) {
+            this->sendTimeout = std::stoul(v.get_str());
+       }
+
+       if(find(jObj, "indexes", v) && !v.get_str().empty()) {
+            boost::split(this->indexes, v.get_str(), boost::is_any_of(","));
+       }
+
+       if(find(jObj, "sparseArrays", v) && !v.get_str().empty()) {
+            boost::split(this->sparseArrays, v.get_str(), boost::is_any_of(","));
+       }
      } catch (exception& e) {
        error("Unable to load janosh configuration", e.what());
      }
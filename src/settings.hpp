@@ -29,6 +29,25 @@ public:
   string ktopts;
   string bindUrl;
   string connectUrl;
+  string backend;
+  string embeddedDb;
+  string remoteHost;
+  int32_t remotePort;
+  size_t bulkBatchSize;
+  size_t importThreads;
+  size_t scanChunkSize;
+  size_t responseChunkSize;
+  string directoryCacheScope;
+  size_t valueCacheCapacity;
+  size_t valueCacheShards;
+  size_t memberIndexCapacity;
+  size_t jsonPathCacheSize;
+  vector<string> indexes;
+  vector<string> sparseArrays;
+  size_t fetchThreads;
+  size_t healthCheckInterval;
+  size_t connectionBufferSize;
+  size_t sendTimeout;
 
   Settings();
   template<typename T> void error(const string& msg, T t, int exitcode=1) {
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+#include "sparse_array.hpp"
+#include "member_index.hpp"
+#include "exception.hpp"
+
+namespace janosh {
+  vector<vector<string>> SparseArray::patterns_;
+  const size_t SparseArray::GAP = 1 << 16;
+
+  void SparseArray::define(const vector<string>& patterns) {
+    patterns_.clear();
+    for(const string& p : patterns) {
+      string pattern = boost::trim_copy(p);
+      if(pattern.empty())
+        continue;
+
+      if(boost::ends_with(pattern, "/."))
+        pattern.erase(pattern.size() - 2);
+
+      vector<string> components;
+      boost::split(components, pattern, boost::is_any_of("/"));
+      if(pattern.empty() || pattern.at(0) != '/' || std::count(components.begin() + 1, components.end(), "") > 0)
+        throw config_exception() << string_info({"invalid sparse array pattern", p});
+
+      patterns_.push_back(components);
+    }
+  }
+
+  bool SparseArray::enabled() {
+    return !patterns_.empty();
+  }
+
+  bool SparseArray::matches(const Path& array) {
+    if(patterns_.empty())
+      return false;
+
+    vector<string> components;
+    boost::split(components, array.basePath().pretty(), boost::is_any_of("/"));
+    for(const vector<string>& pattern : patterns_) {
+      if(pattern.size() != components.size())
+        continue;
+
+      size_t i = 0;
+      while(i < pattern.size() && (pattern[i] == "*" || pattern[i] == components[i]))
+        ++i;
+
+      if(i == pattern.size())
+        return true;
+    }
+    return false;
+  }
+
+  bool SparseArray::element(const Path& array, const size_t size, const size_t n, Path& element) {
+    string key;
+    if(!MemberIndex::member(array.asDirectory(), size, n, key))
+      return false;
+
+    element = Path(key).basePath();
+    return true;
+  }
+
+  bool SparseArray::rank(const Path& array, const size_t size, const Path& element, size_t& n) {
+    return MemberIndex::rank(array.asDirectory(), size, element.basePath().key(), n);
+  }
+
+  size_t SparseArray::next(const Path& array, const size_t size) {
+    if(size == 0)
+      return 0;
+
+    Path last;
+    if(!element(array, size, size - 1, last))
+      throw db_exception() << string_info({"corrupted array detected", array.pretty()});
+
+    return last.parseIndex() + GAP;
+  }
+
+  bool SparseArray::slot(const Path& array, const size_t size, const size_t src, const size_t dest, size_t& key) {
+    //the shifted element ends up in front of the destination when it moves backwards and behind it otherwise
+    const size_t before = src > dest ? dest - 1 : dest;
+    const size_t after = src > dest ? dest : dest + 1;
+    size_t lower = 0;
+    Path neighbour;
+
+    if(src < dest || dest > 0) {
+      if(!element(array, size, before, neighbour))
+        throw db_exception() << string_info({"corrupted array detected", array.pretty()});
+      lower = neighbour.parseIndex() + 1;
+    }
+
+    if(after == size) {
+      key = lower - 1 + GAP;
+      return true;
+    }
+
+    if(!element(array, size, after, neighbour))
+      throw db_exception() << string_info({"corrupted array detected", array.pretty()});
+
+    const size_t upper = neighbour.parseIndex();
+    if(lower >= upper)
+      return false;
+
+    key = lower + (upper - lower) / 2;
+    return true;
+  }
+}
@@ -0,0 +1,86 @@
+#ifndef _JANOSH_SPARSE_ARRAY_HPP
+#define _JANOSH_SPARSE_ARRAY_HPP
+
+#include <string>
+#include <vector>
+#include "path.hpp"
+
+namespace janosh {
+  using std::string;
+  using std::vector;
+
+  /**
+   * Arrays that drop elements without renumbering the elements that follow them.
+   * They are selected by patterns like "/playlists/<*>/entries" (written without the brackets), "*" matching any one component.
+   * The element keys of a sparse array may have gaps. The n-th element is the one with the n-th smallest key,
+   * so the member index serves as the offset map that resolves logical indices to keys.
+   * A removed element leaves a gap instead of a tombstone record.
+   * Appended elements are GAP keys apart, so a shifted element can move to a free key between its new neighbours
+   * without renumbering any other element.
+   * Requests name elements by their logical index, Janosh::resolve looks up their keys.
+   * Outputs show logical indices, changes are published with the keys.
+   * The member index needs room for the sparse arrays in use, otherwise every lookup lists the elements again.
+   */
+  class SparseArray {
+    static vector<vector<string>> patterns_;
+  public:
+    static const size_t GAP;
+
+    /**
+     * Defines the arrays to keep sparse.
+     * @param patterns pretty paths of arrays with or without the trailing "/."
+     */
+    static void define(const vector<string>& patterns);
+
+    /**
+     * @return true if any sparse arrays are defined
+     */
+    static bool enabled();
+
+    /**
+     * @param array the path of an array
+     * @return true if the array is sparse
+     */
+    static bool matches(const Path& array);
+
+    /**
+     * Looks up the n-th element of a sparse array.
+     * @param array the path of the array
+     * @param size the size stored in the array record
+     * @param n the logical index of the element
+     * @param element receives the path of the element, without "/." for directories
+     * @return true if the element was found
+     */
+    static bool element(const Path& array, const size_t size, const size_t n, Path& element);
+
+    /**
+     * Looks up the logical index of an element of a sparse array.
+     * @param array the path of the array
+     * @param size the size stored in the array record
+     * @param element the path of the element
+     * @param n receives the logical index
+     * @return true if the element was found
+     */
+    static bool rank(const Path& array, const size_t size, const Path& element, size_t& n);
+
+    /**
+     * @param array the path of the array
+     * @param size the size stored in the array record
+     * @return the index of the key the next element is appended at
+     */
+    static size_t next(const Path& array, const size_t size);
+
+    /**
+     * Looks up a free key for an element that is shifted from one logical index to another.
+     * @param array the path of the array
+     * @param size the size stored in the array record
+     * @param src the logical index of the shifted element
+     * @param dest the logical index the element is shifted to
+     * @param key receives the free key
+     * @return false if there is no free key between the new neighbours of the element
+     */
+    static bool slot(const Path& array, const size_t size, const size_t src, const size_t dest, size_t& key);
+  };
+}
+
+#endif
@@ -0,0 +1,42 @@
+#include <algorithm>
+#include <memory>
+#include "storage_backend.hpp"
+#include "remote_backend.hpp"
+#include "embedded_backend.hpp"
+#include "exception.hpp"
+
+namespace janosh {
+
+  StorageBackend* StorageBackend::make(const Settings& settings) {
+    if(settings.backend == "remote") {
+      return new RemoteBackend(settings.remoteHost, settings.remotePort);
+    } else if(settings.backend == "embedded") {
+      return new EmbeddedBackend(settings.embeddedDb);
+    }
+
+    throw config_exception() << msg_info("Unknown storage backend: " + settings.backend);
+  }
+
+  int64_t StorageBackend::list_keys(const string& prefix, const string& start, const size_t max, std::vector<string>* keys) {
+    std::unique_ptr<StorageCursor> cur(cursor());
+    if(!cur->jump(std::max(prefix, start)))
+      return 0;
+
+    int64_t cnt = 0;
+    string key;
+    while(static_cast<size_t>(cnt) < max && cur->get_key(&key, true) && key.compare(0, prefix.size(), prefix) == 0) {
+      keys->push_back(key);
+      ++cnt;
+    }
+    return cnt;
+  }
+
+  bool StorageBackend::ping() {
+    return true;
+  }
+
+  void StorageBackend::reconnect() {
+    close();
+    open();
+  }
+}
@@ -0,0 +1,86 @@
+#ifndef _JANOSH_STORAGE_BACKEND_HPP
+#define _JANOSH_STORAGE_BACKEND_HPP
+
+#include <string>
+#include <map>
+#include <vector>
+#include <cstdint>
+#include "settings.hpp"
+
+namespace janosh {
+  using std::string;
+
+  /**
+   * A cursor over the ordered key space of a storage backend.
+   * Mirrors the subset of the kyoto cursor api janosh relies on.
+   */
+  class StorageCursor {
+  public:
+    virtual ~StorageCursor() {}
+
+    virtual bool jump() = 0;
+    virtual bool jump(const string& key) = 0;
+    virtual bool jump_back(const string& key) = 0;
+    virtual bool step() = 0;
+    virtual bool step_back() = 0;
+    virtual bool set_value_str(const string& value) = 0;
+    virtual bool remove() = 0;
+    virtual bool get_key(string* key, bool step = false) = 0;
+    virtual bool get_value(string* value, bool step = false) = 0;
+    virtual bool get(string* key, string* value, bool step = false) = 0;
+  };
+
+  typedef StorageCursor Cursor;
+
+  /**
+   * An ordered key/value store records are persisted in.
+   */
+  class StorageBackend {
+  public:
+    virtual ~StorageBackend() {}
+
+    virtual void open() = 0;
+    virtual void close() = 0;
+    virtual StorageCursor* cursor() = 0;
+
+    virtual bool set(const string& key, const string& value) = 0;
+    virtual bool add(const string& key, const string& value) = 0;
+    virtual bool replace(const string& key, const string& value) = 0;
+    virtual bool remove(const string& key) = 0;
+    virtual bool get(const string& key, string* value) = 0;
+    virtual bool clear() = 0;
+
+    /**
+     * Bulk operations. They return the number of affected records or -1 on failure.
+     */
+    virtual int64_t set_bulk(const std::map<string, string>& recs) = 0;
+    virtual int64_t remove_bulk(const std::vector<string>& keys) = 0;
+    virtual int64_t get_bulk(const std::vector<string>& keys, std::map<string, string>* recs) = 0;
+    virtual int64_t match_prefix(const string& prefix, std::vector<string>* keys) = 0;
+
+    /**
+     * Lists keys in key order with one bounded request.
+     * The default walks a cursor, which is cheap for backends in the same process.
+     * @param prefix only keys with this prefix are listed
+     * @param start keys below start are skipped
+     * @param max the maximum number of keys to list
+     * @param keys receives the keys
+     * @return the number of keys listed or -1 on failure
+     */
+    virtual int64_t list_keys(const string& prefix, const string& start, const size_t max, std::vector<string>* keys);
+
+    /**
+     * Checks if the backend still answers. Backends without a connection are always healthy.
+     */
+    virtual bool ping();
+
+    /**
+     * Closes and reopens the backend. Cursors of the old connection must not be used anymore.
+     */
+    virtual void reconnect();
+
+    static StorageBackend* make(const Settings& settings);
+  };
+}
+
+#endif
@@ -9,11 +9,14 @@
 #include "tcp_client.hpp"
 #include "logger.hpp"
 #include "compress.hpp"
+#include "chunked_stream.hpp"
+#include "exception.hpp"
+#include <stdexcept>
 
 
 namespace janosh {
 
-TcpClient::TcpClient() {
+TcpClient::TcpClient() : seq_(0), connected_(false) {
 }
 
 TcpClient::~TcpClient() {
@@ -21,81 +24,210 @@ TcpClient::~TcpClient() {
 
 void TcpClient::connect(string url) {
   sock_.connect(url.c_str());
+  connected_ = true;
   send("begin");
-  string msg;
-  receive(msg);
-  assert(msg == "bok");
+  receiveReply("bok");
+}
+
+void TcpClient::sendBytes(const char* data, size_t len) {
+  while(len > 0) {
+    ssize_t n = sock_.snd(data, len);
+    if(n <= 0)
+      throw std::runtime_error("send failed");
+    data += n;
+    len -= n;
+  }
+}
+
+void TcpClient::receiveBytes(char* data, size_t len) {
+  while(len > 0) {
+    ssize_t n = sock_.rcv(data, len);
+    if(n <= 0)
+      throw std::runtime_error("receive failed");
+    data += n;
+    len -= n;
+  }
 }
 
 void TcpClient::send(const string& msg) {
   uint64_t len = msg.size();
-  sock_.snd((char*) &len, sizeof(len));
-  sock_.snd(msg.c_str(), msg.size());
+  sendBytes((char*) &len, sizeof(len));
+  sendBytes(msg.data(), msg.size());
 }
 
+/**
+ * Drops the connection after the response stream got out of step. The unread frames
+ * can't be assigned to requests anymore and the daemon aborts the transaction.
+ */
+void TcpClient::reset() {
+  LOG_ERR_STR("Resetting the connection");
+  pending_.clear();
+  connected_ = false;
+  sock_.destroy();
+}
 
-void TcpClient::receive(string& msg) {
-  uint64_t len;
-  sock_.rcv((char*) &len, sizeof(len));
-  msg.resize(len);
-  sock_ >> msg;
+/**
+ * Receives the framed reply to a transaction message.
+ */
+void TcpClient::receiveReply(const string& expected) {
+  ResponseHeader header;
+  string reply;
+  this->receiveFrame(header, reply);
+  if(header.seq != 0 || reply != expected)
+    throw janosh_exception() << string_info({"unexpected transaction reply", expected, reply});
 }
 
-bool endsWith(const std::string &mainStr, const std::string &toMatch)
-{
-  if(mainStr.size() >= toMatch.size() &&
-      mainStr.compare(mainStr.size() - toMatch.size(), toMatch.size(), toMatch) == 0)
-      return true;
-    else
-      return false;
+/**
+ * Receives a response frame and appends its payload.
+ */
+void TcpClient::receiveFrame(ResponseHeader& header, string& payload) {
+  receiveBytes((char*) &header, sizeof(header));
+  size_t offset = payload.size();
+  payload.resize(offset + header.length);
+  receiveBytes(&payload[offset], header.length);
 }
 
-int TcpClient::run(Request& req, std::ostream& out) {
+/**
+ * Receives the response of the oldest pending request.
+ * @param payload collects the output if out is NULL. otherwise it is a buffer for single frames.
+ * @param out the stream frames are written to as they arrive. may be NULL.
+ * @return the return code of the command or -1 if the request failed.
+ */
+int TcpClient::receiveResponse(string& payload, std::ostream* out) {
   int returnCode = -1;
+  if(pending_.empty()) {
+    LOG_ERR_STR("No pending request to collect");
+    return returnCode;
+  }
+
+  const uint64_t seq = pending_.front();
+  pending_.pop_front();
   try {
-    std::ostringstream request_stream;
-    write_request(req, request_stream);
-    this->send(request_stream.str());
-    this->receive(rcvBuffer_);
-
-    std::stringstream response_stream;
-    response_stream.write((char*)rcvBuffer_.data(), rcvBuffer_.size());
-    string line;
-    while (response_stream) {
-      std::getline(response_stream, line);
-      if(endsWith(line,"__JANOSH_EOF")) {
-        out << line.substr(0, line.size() - string("__JANOSH_EOF").size());
-        std::getline(response_stream, line);
-        returnCode = std::stoi(line);
-
-        if (returnCode == 0) {
-          LOG_DEBUG_STR("Successful");
-        } else {
-          LOG_INFO_MSG("Failed", returnCode);
-        }
-
-        break;
+    ResponseHeader header;
+    payload.clear();
+    do {
+      this->receiveFrame(header, payload);
+      if(header.seq != seq)
+        throw std::runtime_error("response out of sequence");
+
+      if(out != NULL) {
+        out->write(payload.data(), payload.size());
+        payload.clear();
       }
-      out << line << '\n';
+    } while(header.flags & RESPONSE_MORE);
+
+    returnCode = header.status;
+    if (returnCode == 0) {
+      LOG_DEBUG_STR("Successful");
+    } else {
+      LOG_INFO_MSG("Failed", returnCode);
     }
   } catch (std::exception& ex) {
     LOG_ERR_MSG("Caught in tcp_client run", ex.what());
+    //the position in the response stream is unknown
+    reset();
+    returnCode = -1;
   }
   return returnCode;
 }
 
+/**
+ * Sends a request without waiting for its response. The worker executes requests in the
+ * order they are submitted and collect() receives their responses in the same order.
+ * @return false if the request couldn't be sent.
+ */
+bool TcpClient::submit(Request& req) {
+  if(!connected_) {
+    LOG_ERR_STR("Not connected");
+    return false;
+  }
+
+  req.seq_ = ++seq_;
+  string request;
+  try {
+    write_request(req, request);
+  } catch (std::exception& ex) {
+    LOG_ERR_MSG("Caught in tcp_client submit", ex.what());
+    return false;
+  }
+
+  try {
+    this->send(request);
+  } catch (std::exception& ex) {
+    LOG_ERR_MSG("Caught in tcp_client submit", ex.what());
+    //a partially sent request leaves the request stream out of step
+    reset();
+    return false;
+  }
+
+  pending_.push_back(req.seq_);
+  return true;
+}
+
+int TcpClient::collect(std::ostream& out) {
+  //output chunks are written as they arrive.
+  return receiveResponse(rcvBuffer_, &out);
+}
+
+int TcpClient::collect(string& payload) {
+  //the payload is received in place without going through a stream.
+  return receiveResponse(payload, NULL);
+}
+
+size_t TcpClient::pending() const {
+  return pending_.size();
+}
+
+/**
+ * Sends a request and receives its response. Refused while submitted requests haven't been collected,
+ * as the response of the oldest of them would be taken for the response of this one.
+ */
+int TcpClient::run(Request& req, std::ostream& out) {
+  if(!pending_.empty()) {
+    LOG_ERR_STR("Collect the submitted requests before running another one");
+    return -1;
+  }
+
+  if(!submit(req))
+    return -1;
+  return collect(out);
+}
+
+int TcpClient::run(Request& req, string& payload) {
+  if(!pending_.empty()) {
+    LOG_ERR_STR("Collect the submitted requests before running another one");
+    return -1;
+  }
+
+  if(!submit(req))
+    return -1;
+  return collect(payload);
+}
+
 void TcpClient::close(bool commit) {
     LOG_DEBUG_STR("Closing socket");
-    if(commit)
+    if(!connected_)
+      return;
+
+    //responses of pipelined requests arrive before the transaction reply.
+    //a failed request whose response was never collected aborts the transaction.
+    while(!pending_.empty()) {
+      if(collect(rcvBuffer_) != 0)
+        commit = false;
+    }
+
+    //collecting may have reset the connection
+    if(!connected_)
+      return;
+
+    if(commit) {
       send("commit");
-    else
+      receiveReply("cok");
+    } else {
       send("abort");
-    string msg;
-    receive(msg);
-    if(commit)
-      assert(msg == "cok");
-    else
-      assert(msg == "aok");
+      receiveReply("aok");
+    }
+    connected_ = false;
     sock_.destroy();
 }
 } /* namespace janosh */
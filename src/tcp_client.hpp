@@ -4,8 +4,10 @@
 
 #include "format.hpp"
 #include "request.hpp"
+#include "chunked_stream.hpp"
 #include <string>
 #include <vector>
+#include <deque>
 #include <libsocket/unixclientstream.hpp>
 #include <libsocket/exception.hpp>
 
@@ -19,14 +21,28 @@ using std::vector;
 class TcpClient {
   ls::unix_stream_client sock_;
   std::string rcvBuffer_;
+  uint64_t seq_;
+  //sequence numbers of the submitted requests that haven't been collected yet
+  std::deque<uint64_t> pending_;
+  bool connected_;
+  void sendBytes(const char* data, size_t len);
+  void receiveBytes(char* data, size_t len);
+  void receiveFrame(ResponseHeader& header, string& payload);
+  int receiveResponse(string& payload, std::ostream* out);
+  void receiveReply(const string& expected);
+  void reset();
 
 public:
 	TcpClient();
 	virtual ~TcpClient();
 	void connect(string url);
 	void send(const string& msg);
-	void receive(string& msg);
 	int run(Request& req, std::ostream& out);
+	int run(Request& req, string& payload);
+	bool submit(Request& req);
+	int collect(std::ostream& out);
+	int collect(string& payload);
+	size_t pending() const;
 	void close(bool commit);
 };
 
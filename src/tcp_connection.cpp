@@ -0,0 +1,164 @@
+#include "tcp_connection.hpp"
+#include "request.hpp"
+#include "exception.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+
+namespace janosh {
+
+TcpConnection::TcpConnection(ls::unix_stream_client* client, const size_t bufferSize, const size_t sendTimeout) :
+    client_(client),
+    fd_(client->getfd()),
+    consumed_(0),
+    sent_(0),
+    skip_(0),
+    closed_(false),
+    bufferSize_(bufferSize),
+    sendTimeout_(sendTimeout) {
+}
+
+TcpConnection::~TcpConnection() {
+  client_->destroy();
+  delete client_;
+}
+
+int TcpConnection::fd() const {
+  return fd_;
+}
+
+bool TcpConnection::isClosed() const {
+  return closed_;
+}
+
+bool TcpConnection::hasOutput() const {
+  return sent_ < output_.size();
+}
+
+bool TcpConnection::wantsInput() const {
+  return !closed_ && input_.size() - consumed_ < bufferSize_;
+}
+
+bool TcpConnection::receiveAvailable() {
+  char buf[16384];
+  while(wantsInput()) {
+    ssize_t n = ::recv(fd_, buf, sizeof(buf), MSG_DONTWAIT);
+    if(n > 0) {
+      input_.append(buf, n);
+    } else if(n < 0 && errno == EINTR) {
+      continue;
+    } else if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    } else {
+      closed_ = true;
+    }
+  }
+  return !closed_;
+}
+
+bool TcpConnection::nextMessage(string& msg) {
+  if(skip_ > 0) {
+    const size_t skipped = std::min<uint64_t>(skip_, input_.size() - consumed_);
+    consumed_ += skipped;
+    skip_ -= skipped;
+  }
+
+  const size_t available = input_.size() - consumed_;
+  uint64_t len;
+  if(skip_ == 0 && available >= sizeof(len)) {
+    std::memcpy(&len, input_.data() + consumed_, sizeof(len));
+    if(len > bufferSize_ - sizeof(len)) {
+      //the failure is reported with the sequence number of the request, so wait for its header
+      if(available < sizeof(len) + REQUEST_HEADER_SIZE && !closed_) {
+        input_.erase(0, consumed_);
+        consumed_ = 0;
+        return false;
+      }
+
+      LOG_ERR_MSG("Request exceeds the connection buffer size", len);
+      const uint64_t seq = read_request_seq(input_.data() + consumed_ + sizeof(len), available - sizeof(len));
+      //the request is discarded as it arrives, so the client can still finish sending it and read the failure
+      skip_ = sizeof(len) + len;
+      sendFrame({0, 1, 0, seq}, NULL);
+      return nextMessage(msg);
+    }
+
+    if(available - sizeof(len) >= len) {
+      msg.assign(input_, consumed_ + sizeof(len), len);
+      consumed_ += sizeof(len) + len;
+      return true;
+    }
+  }
+
+  //keep only the incomplete rest
+  input_.erase(0, consumed_);
+  consumed_ = 0;
+  return false;
+}
+
+bool TcpConnection::flush() {
+  while(hasOutput()) {
+    ssize_t n = ::send(fd_, output_.data() + sent_, output_.size() - sent_, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if(n > 0) {
+      sent_ += n;
+    } else if(n < 0 && errno == EINTR) {
+      continue;
+    } else if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    } else {
+      throw janosh_exception() << msg_info("send failed");
+    }
+  }
+
+  if(!hasOutput()) {
+    output_.clear();
+    sent_ = 0;
+    return true;
+  } else if(sent_ > output_.size() / 2) {
+    output_.erase(0, sent_);
+    sent_ = 0;
+  }
+  return false;
+}
+
+/**
+ * Queues data and sends what the socket takes. Only if more than bufferSize bytes are pending
+ * the worker waits for the client. It gives up on the client if it doesn't take any bytes
+ * for sendTimeout milliseconds.
+ */
+void TcpConnection::sendBytes(const char* data, size_t len) {
+  if(len > 0)
+    output_.append(data, len);
+  if(flush())
+    return;
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(sendTimeout_);
+  while(output_.size() - sent_ > bufferSize_) {
+    //a pipelining client may be blocked writing ahead. keep reading so neither side waits for the other.
+    receiveAvailable();
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    if(left.count() <= 0)
+      throw janosh_exception() << msg_info("send timed out");
+
+    struct pollfd p;
+    p.fd = fd_;
+    p.events = wantsInput() ? (POLLOUT | POLLIN) : POLLOUT;
+    p.revents = 0;
+    ::poll(&p, 1, left.count());
+    const size_t pending = output_.size() - sent_;
+    flush();
+    if(output_.size() - sent_ < pending)
+      deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(sendTimeout_);
+  }
+}
+
+void TcpConnection::sendFrame(const ResponseHeader& header, const char* data) {
+  output_.append((const char*) &header, sizeof(header));
+  sendBytes(data, header.length);
+}
+
+} /* namespace janosh */
@@ -0,0 +1,69 @@
+#ifndef _JANOSH_TCP_CONNECTION_HPP
+#define _JANOSH_TCP_CONNECTION_HPP
+
+#include <string>
+#include <libsocket/unixclientstream.hpp>
+#include "chunked_stream.hpp"
+
+namespace janosh {
+namespace ls = libsocket;
+using std::string;
+
+/**
+ * A client connection of the daemon. Incoming bytes are buffered until they form complete
+ * messages, so a connection only occupies a worker while it has requests to execute.
+ * Output the client doesn't take right away is buffered as well and flushed when the socket
+ * becomes writable. Both buffers are limited to bufferSize bytes. A request that doesn't fit
+ * into the input buffer is discarded and answered with a failed status.
+ */
+class TcpConnection {
+  ls::unix_stream_client* client_;
+  int fd_;
+  string input_;
+  size_t consumed_;
+  string output_;
+  size_t sent_;
+  uint64_t skip_;
+  bool closed_;
+  const size_t bufferSize_;
+  const size_t sendTimeout_;
+
+public:
+  TcpConnection(ls::unix_stream_client* client, const size_t bufferSize, const size_t sendTimeout);
+  ~TcpConnection();
+
+  int fd() const;
+  bool isClosed() const;
+  bool hasOutput() const;
+
+  /**
+   * @return true if the connection is open and its input buffer isn't full.
+   */
+  bool wantsInput() const;
+
+  /**
+   * Reads everything that is available without blocking.
+   * @return false if the peer closed the connection.
+   */
+  bool receiveAvailable();
+
+  /**
+   * Takes the next complete message from the input buffer. Requests larger than the buffer are
+   * answered with a failed status and skipped.
+   * @return false if there is no complete message.
+   */
+  bool nextMessage(string& msg);
+
+  /**
+   * Sends as much of the buffered output as the socket takes without blocking.
+   * @return true if all output has been sent.
+   */
+  bool flush();
+
+  void sendBytes(const char* data, size_t len);
+  void sendFrame(const ResponseHeader& header, const char* data);
+};
+
+} /* namespace janosh */
+
+#endif
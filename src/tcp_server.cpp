@@ -8,12 +8,16 @@
 #include <iostream>
 #include <sstream>
 #include <functional>
+#include <algorithm>
 #include <thread>
 #include <assert.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <boost/bind.hpp>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <errno.h>
 
 #include "tcp_server.hpp"
 #include "format.hpp"
@@ -37,12 +41,60 @@ using std::ostream;
 TcpServer* TcpServer::instance_;
 
 
-TcpServer::TcpServer(Settings& settings, int maxThreads) : maxThreads_(maxThreads), settings_(settings), threadLimit_(maxThreads) {
+TcpServer::TcpServer(Settings& settings, int maxThreads) : maxThreads_(std::max(maxThreads, 1)), settings_(settings), epoll_(-1) {
   ExitHandler::getInstance()->addExitFunc([&](){this->close();});
 }
 
 void TcpServer::open(string url) {
   clients_.setup(url.c_str());
+  epoll_ = epoll_create1(0);
+  if(epoll_ < 0)
+    throw janosh_exception() << msg_info("epoll_create1 failed");
+
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  if(epoll_ctl(epoll_, EPOLL_CTL_ADD, clients_.getfd(), &ev) < 0)
+    throw janosh_exception() << msg_info("Unable to watch the server socket");
+
+  for(int i = 0; i < maxThreads_; ++i) {
+    std::thread t([=](){
+      this->workerLoop();
+    });
+    t.detach();
+  }
+}
+
+/**
+ * Waits once for input of a connection, or for it to become writable while it has buffered output.
+ * @param op EPOLL_CTL_ADD for new connections, EPOLL_CTL_MOD to rearm.
+ */
+void TcpServer::watch(TcpConnection* conn, const int op) {
+  struct epoll_event ev;
+  ev.events = EPOLLONESHOT;
+  if(conn->wantsInput())
+    ev.events |= EPOLLIN | EPOLLRDHUP;
+  if(conn->hasOutput())
+    ev.events |= EPOLLOUT;
+  ev.data.ptr = conn;
+  if(epoll_ctl(epoll_, op, conn->fd(), &ev) < 0) {
+    LOG_ERR_MSG("Unable to watch connection", conn->fd());
+    delete conn;
+  }
+}
+
+void TcpServer::workerLoop() {
+  Logger::registerThread("TcpWorker");
+  TcpWorker worker(settings_);
+  while(true) {
+    TcpConnection* conn = ready_.pop();
+    if(worker.serve(*conn)) {
+      watch(conn, EPOLL_CTL_MOD);
+    } else {
+      epoll_ctl(epoll_, EPOLL_CTL_DEL, conn->fd(), NULL);
+      delete conn;
+    }
+  }
 }
 
 TcpServer::~TcpServer() {
@@ -52,24 +104,32 @@ TcpServer::~TcpServer() {
 
 void TcpServer::close() {
   clients_.destroy();
+  if(epoll_ >= 0) {
+    ::close(epoll_);
+    epoll_ = -1;
+  }
 }
 
 bool TcpServer::run() {
-  while(true) {
-    threadLimit_.wait();
-    ls::unix_stream_client* client;
-    client = clients_.accept();
+  const int maxEvents = 64;
+  struct epoll_event events[maxEvents];
 
-    std::thread t([=](){
-      Logger::registerThread("TcpWorker");
-      TcpWorker worker(settings_, *client);
-      worker.runSynchron();
-      threadLimit_.notify();
-      delete client;
-      Logger::removeThread();
-    });
-
-    t.detach();
+  while(true) {
+    int n = epoll_wait(epoll_, events, maxEvents, -1);
+    if(n < 0) {
+      if(errno == EINTR)
+        continue;
+      throw janosh_exception() << msg_info("epoll_wait failed");
+    }
+
+    for(int i = 0; i < n; ++i) {
+      if(events[i].data.ptr == NULL) {
+        ls::unix_stream_client* client = clients_.accept();
+        watch(new TcpConnection(client, settings_.connectionBufferSize, settings_.sendTimeout), EPOLL_CTL_ADD);
+      } else {
+        ready_.push(static_cast<TcpConnection*>(events[i].data.ptr));
+      }
+    }
   }
 
   return true;
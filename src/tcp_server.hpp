@@ -9,8 +9,9 @@
 #define TCPSERVER_H_
 
 #include "format.hpp"
-#include "semaphore.hpp"
 #include "settings.hpp"
+#include "queue.hpp"
+#include "tcp_connection.hpp"
 #include <string>
 #include <libsocket/unixserverstream.hpp>
 #include <libsocket/exception.hpp>
@@ -18,17 +19,24 @@
 namespace janosh {
 namespace ls = libsocket;
 
+/**
+ * Multiplexes client connections with epoll. Connections that have input are handed to a fixed
+ * pool of maxThreads workers, so idle connections don't occupy a thread.
+ */
 class TcpServer {
   static TcpServer* instance_;
   int maxThreads_;
   ls::unix_stream_server clients_;
   Settings& settings_;
+  int epoll_;
+  //connections with input. the epoll event of a queued connection is disarmed until a worker is done with it.
+  Queue<TcpConnection*> ready_;
 
   TcpServer(Settings& settings, int maxThreads);
+  void watch(TcpConnection* conn, const int op);
+  void workerLoop();
 
 public:
-  Semaphore threadLimit_;
-
 	virtual ~TcpServer();
 	bool isOpen();
   void open(std::string url);
@@ -11,13 +11,24 @@
 #include "tracker.hpp"
 #include "record.hpp"
 #include "compress.hpp"
+#include "chunked_stream.hpp"
+#include "directory_cache.hpp"
 
 namespace janosh {
 
-TcpWorker::TcpWorker(Settings& settings, ls::unix_stream_client& socket) :
-    JanoshThread("TcpWorker"),
+TcpWorker::TcpWorker(Settings& settings) :
     janosh_(new Janosh(settings)),
-    socket_(socket) {
+    conn_(NULL),
+    seq_(0),
+    lastUse_(),
+    requestFailed_(false) {
+  Record::checkDB(janosh_->settings_);
+}
+
+TcpWorker::~TcpWorker() {
+  DirectoryCache::removeInstancePerThread();
+  if(Record::hasDB())
+    Record::destroyDB();
 }
 
 string reconstructCommandLine(Request& req) {
@@ -54,95 +65,116 @@ string reconstructCommandLine(Request& req) {
 }
 
 
-void TcpWorker::send(const string& msg) {
-  uint64_t len = msg.size();
-  socket_.snd((char*) &len, sizeof(len));
-  socket_.snd(msg.c_str(), msg.size());
+void TcpWorker::sendChunk(const char* data, size_t len) {
+  conn_->sendFrame({len, 0, RESPONSE_MORE, seq_}, data);
+}
+
+void TcpWorker::sendStatus(const int32_t status) {
+  conn_->sendFrame({0, status, 0, seq_}, NULL);
 }
 
+/**
+ * Acknowledges a transaction message. Replies are framed like responses and carry sequence number 0.
+ */
+void TcpWorker::sendReply(const string& reply) {
+  conn_->sendFrame({reply.size(), 0, 0, 0}, reply.data());
+}
 
-void TcpWorker::receive(string& msg) {
-  uint64_t len;
-  socket_.rcv((char*) &len, sizeof(len));
-  msg.resize(len);
-  socket_ >> msg;
+/**
+ * Pings the backend if it has been idle for longer than the health check interval, or if the
+ * previous request failed, and reconnects it if necessary. A missing backend is opened again.
+ * The connection is reused across client sessions.
+ */
+void TcpWorker::checkBackend() {
+  const size_t interval = janosh_->settings_.healthCheckInterval;
+  if(requestFailed_ || !Record::hasDB()
+      || (interval > 0 && std::chrono::steady_clock::now() - lastUse_ >= std::chrono::milliseconds(interval))) {
+    Record::checkDB(janosh_->settings_);
+    requestFailed_ = false;
+  }
 }
 
-void TcpWorker::run() {
+bool TcpWorker::serve(TcpConnection& conn) {
+  conn_ = &conn;
+  conn.receiveAvailable();
   string request;
-  Record::makeDB("127.0.0.1", 8102);
-  while (true) {
-    try {
-      this->receive(request);
-    } catch (std::exception& ex) {
-      printException(ex);
-      LOG_DEBUG_STR("End of request chain");
-      setResult(false);
-      break;
-    }
-    if(request.empty()) {
-      break;
+  bool open = true;
+  try {
+    //no new requests until the client has taken the pending output
+    while(open && conn.flush() && conn.nextMessage(request)) {
+      if(request.empty()) {
+        open = false;
+        break;
+      }
+      this->checkBackend();
+      this->process(request);
+      lastUse_ = std::chrono::steady_clock::now();
     }
+  } catch (std::exception& ex) {
+    printException(ex);
+    LOG_DEBUG_STR("End of request chain");
+    open = false;
+  }
+  //a client that closed its end still gets the responses to the requests it sent
+  return open && (!conn.isClosed() || conn.hasOutput());
+}
 
-    if(request == "begin") {
-      LOG_DEBUG_STR("Transaction begin");
-      janosh_->beginTransaction();
-      send("bok");
-      continue;
-    } else if(request == "commit") {
-      LOG_DEBUG_STR("Transaction commit");
-      janosh_->endTransaction(true);
-      send("cok");
-      continue;
-    } else if(request == "abort") {
-      LOG_DEBUG_STR("Transaction about");
-      janosh_->endTransaction(false);
-      send("aok");
-      continue;
-    }
-    std::ostringstream sso;
-    bool result = false;
-    try {
-      Request req;
-      std::stringstream response_stream;
-      response_stream.write((char*) request.data(), request.size());
-      read_request(req, response_stream);
-
-      LOG_DEBUG_MSG("ppid", req.pinfo_.pid_);
-      LOG_DEBUG_MSG("cmdline", req.pinfo_.cmdline_);
-      LOG_INFO_STR(reconstructCommandLine(req));
-
-      janosh_->setFormat(req.format_);
-
-      if (!req.command_.empty()) {
-        if (req.command_ == "trigger") {
-          req.command_ = "set";
-          req.runTriggers_ = true;
-        }
-
-        Tracker::setDoPublish(req.runTriggers_);
-        JanoshThreadPtr dt(new DatabaseThread(janosh_,req, sso));
-        dt->runSynchron();
-        result = dt->result();
-
-        sso << "__JANOSH_EOF\n" << std::to_string(result ? 0 : 1) << '\n';
-
-        if (!result) {
-          setResult(false);
-        }
-      } else {
-        sso << "__JANOSH_EOF\n" << std::to_string(0) << '\n';
+void TcpWorker::process(const string& request) {
+  if(request == "begin") {
+    LOG_DEBUG_STR("Transaction begin");
+    janosh_->beginTransaction();
+    this->sendReply("bok");
+    return;
+  } else if(request == "commit") {
+    LOG_DEBUG_STR("Transaction commit");
+    janosh_->endTransaction(true);
+    this->sendReply("cok");
+    return;
+  } else if(request == "abort") {
+    LOG_DEBUG_STR("Transaction about");
+    janosh_->endTransaction(false);
+    this->sendReply("aok");
+    return;
+  }
+
+  ChunkedOStream sso([&](const char* data, size_t len) {
+    this->sendChunk(data, len);
+  }, janosh_->settings_.responseChunkSize);
+  bool result = false;
+  try {
+    Request req;
+    seq_ = 0;
+    read_request(req, request.data(), request.size());
+    seq_ = req.seq_;
+
+    LOG_DEBUG_MSG("ppid", req.pinfo_.pid_);
+    LOG_DEBUG_MSG("cmdline", req.pinfo_.cmdline_);
+    LOG_INFO_STR(reconstructCommandLine(req));
+
+    janosh_->setFormat(req.format_);
+
+    if (!req.command_.empty()) {
+      if (req.command_ == "trigger") {
+        req.command_ = "set";
+        req.runTriggers_ = true;
       }
-//      string compressed = compress_string(sso.str());
-      this->send(sso.str());
-      setResult(true);
-    } catch (std::exception& ex) {
-      janosh::printException(ex);
-      setResult(false);
-      sso << "__JANOSH_EOF\n" << std::to_string(1) << '\n';
-      this->send(sso.str());
+
+      Tracker::setDoPublish(req.runTriggers_);
+      DirectoryCache::getInstancePerThread()->beginRequest();
+      JanoshThread::JanoshThreadPtr dt(new DatabaseThread(janosh_,req, sso));
+      dt->runSynchron();
+      result = dt->result();
+      requestFailed_ = !result;
+      sso.finish();
+      this->sendStatus(result ? 0 : 1);
+    } else {
+      this->sendStatus(0);
     }
+  } catch (std::exception& ex) {
+    janosh::printException(ex);
+    requestFailed_ = true;
+    sso.finish();
+    this->sendStatus(1);
   }
-  Record::destroyDB();
 }
 } /* namespace janosh */
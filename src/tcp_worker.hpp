@@ -1,28 +1,41 @@
 #ifndef TCP_WORKER_HPP_
 #define TCP_WORKER_HPP_
 
-#include "janosh_thread.hpp"
 #include "shared_pointers.hpp"
 #include "request.hpp"
-#include "semaphore.hpp"
 #include "janosh.hpp"
-#include <libsocket/unixclientstream.hpp>
-#include <libsocket/exception.hpp>
+#include "chunked_stream.hpp"
+#include "tcp_connection.hpp"
+#include <chrono>
 
 namespace janosh {
-namespace ls = libsocket;
 
-class TcpWorker : public JanoshThread {
+/**
+ * Executes the requests of connections that have input. One worker per thread of the server's pool.
+ * It keeps a Janosh instance and a backend connection for its whole lifetime.
+ */
+class TcpWorker {
   shared_ptr<Janosh> janosh_;
-  ls::unix_stream_client& socket_;
-  Request readRequest();
+  TcpConnection* conn_;
+  uint64_t seq_;
+  std::chrono::steady_clock::time_point lastUse_;
+  bool requestFailed_;
+  void process(const string& request);
+  void checkBackend();
 
 public:
-  explicit TcpWorker(Settings& settings, ls::unix_stream_client& socket);
-  void send(const string& msg);
-  void receive(string& msg);
-  void run();
-  bool connected();
+  explicit TcpWorker(Settings& settings);
+  ~TcpWorker();
+  void sendChunk(const char* data, size_t len);
+  void sendStatus(const int32_t status);
+  void sendReply(const string& reply);
+
+  /**
+   * Executes all complete requests a connection has received so far, unless the client
+   * hasn't taken the output of earlier requests yet.
+   * @return false if the connection ended.
+   */
+  bool serve(TcpConnection& conn);
 };
 
 
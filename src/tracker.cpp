@@ -8,6 +8,10 @@
 #include "tracker.hpp"
 #include "logger.hpp"
 #include "message_queue.hpp"
+#include "directory_cache.hpp"
+#include "value_cache.hpp"
+#include "member_index.hpp"
+#include "secondary_index.hpp"
 #include <sstream>
 
 namespace janosh {
@@ -15,6 +19,9 @@ using std::cerr;
 using std::endl;
 
 map<thread::id, Tracker*> Tracker::instances_;
+std::mutex Tracker::instancesMutex_;
+thread_local Tracker* Tracker::threadInstance_ = NULL;
+
 Tracker::Tracker() :
     printDirective_(DONTPRINT), doPublish_(false), revision_(0) {
 }
@@ -26,7 +33,19 @@ void Tracker::update(const string& key, const string& value, const Operation& op
   update(key, value.c_str(), op);
 }
 
+void Tracker::invalidate(const string& key) {
+  //keys of directories end with "."
+  if(key.back() == '.') {
+    DirectoryCache::invalidate(key);
+  } else if(ValueCache* vc = ValueCache::getInstance()) {
+    vc->invalidate(key);
+  }
+}
+
 void Tracker::update(const string& key, const char* value, const Operation& op) {
+  if((op == WRITE || op == DELETE) && !key.empty()) {
+    invalidate(key);
+  }
   if(doPublish_ && (op == WRITE || op == DELETE))
     MessageQueue::getInstance()->publish(key, (op == WRITE ? "W" : "D"), value);
   if(printDirective_ != DONTPRINT) {
@@ -40,6 +59,24 @@ void Tracker::update(const string& key, const char* value, const Operation& op)
   }
 }
 
+/**
+ * Called once a write or delete announced through update() reached the backend.
+ * A reader may have cached the old value between the announcement and the write,
+ * so the caches are invalidated a second time.
+ */
+void Tracker::settle(const string& key, const string& value, const Operation& op) {
+  if((op == WRITE || op == DELETE) && !key.empty()) {
+    invalidate(key);
+    //the member index is only updated in place once the record exists or is gone
+    if(op == WRITE)
+      MemberIndex::added(key);
+    else
+      MemberIndex::removed(key);
+    //index entries are only made for values that were actually stored
+    SecondaryIndex::update(key);
+  }
+}
+
 size_t Tracker::get(const string& s, const Operation& op) {
   return get(op)[s];
 }
@@ -76,16 +113,33 @@ void Tracker::reset() {
 }
 
 Tracker* Tracker::getInstancePerThread() {
+  if(threadInstance_ != NULL)
+    return threadInstance_;
+
   thread::id tid = std::this_thread::get_id();
+  std::unique_lock<std::mutex> lock(instancesMutex_);
   auto it = instances_.find(tid);
-  Tracker* instance = NULL;
   if(it == instances_.end()) {
-    instance = new Tracker();
-    instances_[tid] = instance;
+    threadInstance_ = new Tracker();
+    instances_[tid] = threadInstance_;
   } else {
-    instance = (*it).second;
+    threadInstance_ = (*it).second;
+  }
+  return threadInstance_;
+}
+
+/**
+ * Frees the tracker of the calling thread. Used by threads that
+ * only live for a single operation, like import workers.
+ */
+void Tracker::removeInstancePerThread() {
+  std::unique_lock<std::mutex> lock(instancesMutex_);
+  auto it = instances_.find(std::this_thread::get_id());
+  if(it != instances_.end()) {
+    delete (*it).second;
+    instances_.erase(it);
   }
-  return instance;
+  threadInstance_ = NULL;
 }
 
 void printHeader(ostream& out) {
@@ -14,6 +14,7 @@
 #include "exception.hpp"
 #include <iostream>
 #include <thread>
+#include <mutex>
 #include "cppzmq/zmq.hpp"
 
 namespace janosh {
@@ -34,11 +35,14 @@ private:
   map<string, size_t> deletes_;
   map<string, size_t> triggers_;
   static map<thread::id, Tracker*> instances_;
+  static std::mutex instancesMutex_;
+  static thread_local Tracker* threadInstance_;
   PrintDirective printDirective_;
   bool doPublish_;
 
   void printMeta(ostream& out);
   void printFull(ostream& out);
+  static void invalidate(const string& key);
   long long revision_;
 public:
   enum Operation {
@@ -53,6 +57,7 @@ public:
 
   void update(const string& key, const string& value, const Operation& op);
   void update(const string& key, const char* value, const Operation& op);
+  void settle(const string& key, const string& value, const Operation& op);
   size_t get(const string& s, const Operation& op);
   map<string, size_t>& get(const Operation& op);
   void reset();
@@ -60,6 +65,7 @@ public:
   string revision();
 
   static Tracker* getInstancePerThread();
+  static void removeInstancePerThread();
   static void setPrintDirective(PrintDirective p);
   static PrintDirective getPrintDirective();
   static void setDoPublish(bool p);
@@ -0,0 +1,115 @@
+#include <functional>
+#include "value_cache.hpp"
+
+namespace janosh {
+
+  ValueCache* ValueCache::instance_ = NULL;
+
+  ValueCache::ValueCache(const size_t capacity, const size_t numShards) :
+      shardCapacity_(0),
+      hits_(0),
+      misses_(0) {
+    size_t n = numShards > 0 ? numShards : 1;
+    shardCapacity_ = (capacity + n - 1) / n;
+    for(size_t i = 0; i < n; ++i)
+      shards_.push_back(new Shard());
+  }
+
+  ValueCache::~ValueCache() {
+    for(Shard* s : shards_)
+      delete s;
+  }
+
+  ValueCache::Shard* ValueCache::shard(const string& path) {
+    return shards_[std::hash<string>()(path) % shards_.size()];
+  }
+
+  bool ValueCache::get(const string& path, Value& value) {
+    Shard* s = shard(path);
+    std::unique_lock<std::mutex> lock(s->mutex_);
+    auto it = s->index_.find(path);
+    if(it == s->index_.end()) {
+      ++misses_;
+      return false;
+    }
+
+    s->lru_.splice(s->lru_.begin(), s->lru_, (*it).second);
+    value = (*it).second->second;
+    ++hits_;
+    return true;
+  }
+
+  size_t ValueCache::generation(const string& path) {
+    Shard* s = shard(path);
+    std::unique_lock<std::mutex> lock(s->mutex_);
+    return s->generation_;
+  }
+
+  void ValueCache::put(const string& path, const Value& value, const size_t generation) {
+    Shard* s = shard(path);
+    std::unique_lock<std::mutex> lock(s->mutex_);
+    if(s->generation_ != generation)
+      return;
+
+    auto it = s->index_.find(path);
+    if(it != s->index_.end()) {
+      (*it).second->second = value;
+      s->lru_.splice(s->lru_.begin(), s->lru_, (*it).second);
+      return;
+    }
+
+    s->lru_.push_front({path, value});
+    s->index_[path] = s->lru_.begin();
+
+    if(s->lru_.size() > shardCapacity_) {
+      s->index_.erase(s->lru_.back().first);
+      s->lru_.pop_back();
+    }
+  }
+
+  void ValueCache::invalidate(const string& path) {
+    Shard* s = shard(path);
+    std::unique_lock<std::mutex> lock(s->mutex_);
+    ++s->generation_;
+    auto it = s->index_.find(path);
+    if(it != s->index_.end()) {
+      s->lru_.erase((*it).second);
+      s->index_.erase(it);
+    }
+  }
+
+  void ValueCache::clear() {
+    for(Shard* s : shards_) {
+      std::unique_lock<std::mutex> lock(s->mutex_);
+      ++s->generation_;
+      s->lru_.clear();
+      s->index_.clear();
+    }
+  }
+
+  size_t ValueCache::hits() {
+    return hits_;
+  }
+
+  size_t ValueCache::misses() {
+    return misses_;
+  }
+
+  size_t ValueCache::size() {
+    size_t n = 0;
+    for(Shard* s : shards_) {
+      std::unique_lock<std::mutex> lock(s->mutex_);
+      n += s->lru_.size();
+    }
+    return n;
+  }
+
+  void ValueCache::init(const size_t capacity, const size_t numShards) {
+    if(instance_ == NULL && capacity > 0)
+      instance_ = new ValueCache(capacity, numShards);
+  }
+
+  ValueCache* ValueCache::getInstance() {
+    return instance_;
+  }
+}
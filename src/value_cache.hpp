@@ -0,0 +1,70 @@
+#ifndef _JANOSH_VALUE_CACHE_HPP
+#define _JANOSH_VALUE_CACHE_HPP
+
+#include <list>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include "value.hpp"
+
+namespace janosh {
+  using std::string;
+
+  /**
+   * A daemon wide LRU cache of leaf values keyed by pretty path.
+   * The key space is split into shards with their own lock and capacity.
+   * Every write or delete announced through the Tracker invalidates the affected key.
+   */
+  class ValueCache {
+    typedef std::list<std::pair<string, Value>> LruList;
+
+    struct Shard {
+      std::mutex mutex_;
+      LruList lru_;
+      std::unordered_map<string, LruList::iterator> index_;
+      //bumped on every invalidation of the shard. protects against caching values read before a write.
+      size_t generation_ = 0;
+    };
+
+    std::vector<Shard*> shards_;
+    size_t shardCapacity_;
+    std::atomic<size_t> hits_;
+    std::atomic<size_t> misses_;
+
+    static ValueCache* instance_;
+
+    ValueCache(const size_t capacity, const size_t numShards);
+    Shard* shard(const string& path);
+  public:
+    virtual ~ValueCache();
+
+    bool get(const string& path, Value& value);
+
+    /**
+     * Returns the generation of the shard of path. Take it before reading a value from the backend.
+     */
+    size_t generation(const string& path);
+
+    /**
+     * Caches a value unless the key was invalidated since the generation was taken.
+     */
+    void put(const string& path, const Value& value, const size_t generation);
+    void invalidate(const string& path);
+    void clear();
+
+    size_t hits();
+    size_t misses();
+    size_t size();
+
+    static void init(const size_t capacity, const size_t numShards);
+
+    /**
+     * @return The cache or NULL if it is disabled.
+     */
+    static ValueCache* getInstance();
+  };
+}
+
+#endif
@@ -5,6 +5,7 @@
 HASH=
 DEBUG=
 VERBOSE=
+EMBEDDED=
 
 function prepare() {
   [ -z "$HASH" ] && echo
@@ -85,6 +86,16 @@ function test_remove() {
   janosh remove "/array/*"            || return 1
   janosh mkarr /array/#1/.          && return 1
   [ `janosh size /array/.` -eq 0 ]  || return 1
+  janosh mkobj /array/#0/.          || return 1
+  janosh set /array/#0/label 0      || return 1
+  janosh mkobj /array/#1/.          || return 1
+  janosh set /array/#1/label 1      || return 1
+  janosh mkobj /array/#2/.          || return 1
+  janosh set /array/#2/label 2      || return 1
+  janosh remove /array/#0/.         || return 1
+  [ `janosh size /array/.` -eq 2 ]  || return 1
+  [ `janosh -r get /array/#0/label` -eq 1 ] || return 1
+  [ `janosh -r get /array/#1/label` -eq 2 ] || return 1
   janosh mkobj /object/.            || return 1
   janosh add /object/0 1            || return 1
   janosh add /object/0 0            && return 1
@@ -94,6 +105,50 @@ function test_remove() {
   janosh size /object/.             && return 1 || return 0
 }
 
+# /sparse is a sparse array in the daemon started with -e. removing an element keeps the keys of the others.
+function test_sparse_remove() {
+  janosh mkarr /sparse/.                    || return 1
+  janosh append /sparse/. 0 1 2 3 4         || return 1
+  janosh remove /sparse/#0                  || return 1
+  janosh remove /sparse/#1                  || return 1
+  [ `janosh size /sparse/.` -eq 3 ]         || return 1
+  [ "`janosh -r get /sparse/. | tr '\n' ' '`" == "1 3 4 " ] || return 1
+  [ `janosh -r get /sparse/#2` -eq 4 ]      || return 1
+  janosh set /sparse/#3 5                   || return 1
+  janosh set /sparse/#5 0                   && return 1
+  [ "`janosh -r get /sparse/. offset=1 limit=2 | tr '\n' ' '`" == "3 4 " ] || return 1
+  janosh mkobj /sparse/#4/.                 || return 1
+  janosh set /sparse/#4/label x             || return 1
+  janosh remove /sparse/#0                  || return 1
+  [ "`janosh -r get /sparse/#3/label`" == "x" ] || return 1
+  [ "`janosh -b get /sparse/#3/label`" == "( [/sparse/#3/label]='x' )" ] || return 1
+  [ "`janosh -r get /sparse/. reverse=true limit=1 fields=label`" == "x" ] || return 1
+  [ "`janosh filter /sparse/. '$.sparse[1]'`" == "4" ] || return 1
+  [ "`janosh filter /sparse/. '$.sparse[3].label'`" == "x" ] || return 1
+  [ "`janosh filter /sparse/. '$.sparse[*].label'`" == "x" ] || return 1
+  janosh remove /sparse/#3/.                || return 1
+  [ "`janosh -r get /sparse/. | tr '\n' ' '`" == "3 4 5 " ] || return 1
+}
+
+function test_sparse_shift() {
+  janosh mkarr /sparse/.                    || return 1
+  janosh append /sparse/. 0 1 2 3 4         || return 1
+  before="`janosh dump`"
+  janosh shift /sparse/#0 /sparse/#3        || return 1
+  [ "`janosh -r get /sparse/. | tr '\n' ' '`" == "1 2 3 0 4 " ] || return 1
+  [ `diff <(echo "$before") <(janosh dump) | grep -c '^[<>]'` -eq 2 ] || return 1
+  janosh shift /sparse/#4 /sparse/#1        || return 1
+  [ "`janosh -r get /sparse/. | tr '\n' ' '`" == "1 4 2 3 0 " ] || return 1
+  for i in `seq 20`; do janosh shift /sparse/#4 /sparse/#0 || return 1; done
+  [ "`janosh -r get /sparse/. | tr '\n' ' '`" == "1 4 2 3 0 " ] || return 1
+  janosh mkobj /sparse/#5/.                 || return 1
+  janosh set /sparse/#5/label x             || return 1
+  janosh shift /sparse/#5/. /sparse/#0/.    || return 1
+  [ "`janosh -r get /sparse/#0/label`" == "x" ] || return 1
+  [ "`janosh -r get /sparse/#1`" == "1" ]   || return 1
+  [ `janosh size /sparse/.` -eq 6 ]         || return 1
+}
+
 function test_replace() {
   janosh mkarr /array/.             || return 1
   janosh append /array/. 0 		      || return 1
@@ -184,6 +239,176 @@ function test_shift_dir() {
   [ `janosh -r get /array/#3/label` -eq 0  ] || return 1
 }
 
+# reads race the writes to the same record. a read must never see a value older than the last completed write.
+function test_cache_coherence() {
+  janosh mkobj /object/.                  || return 1
+  janosh set /object/value 0              || return 1
+  for i in `seq 1 50`; do
+    janosh -r get /object/value > /dev/null &
+    janosh set /object/value $i           || return 1
+    wait
+    [ `janosh -r get /object/value` -eq $i ] || return 1
+    [ `janosh size /object/.` -eq 1 ]     || return 1
+  done
+}
+
+function test_batch() {
+  janosh mkobj /object/.                    || return 1
+  janosh batch set 2 /object/a 1 add 2 /object/b 2 add 2 /object/a 3 || return 1
+  [ `janosh -r get /object/a` -eq 1 ]       || return 1
+  [ `janosh -r get /object/b` -eq 2 ]       || return 1
+  [ "`janosh batch size 1 /object/. add 2 /object/a 0 | tr '\n' ' '`" == "0 2 2 1 0 " ] || return 1
+  janosh batch trigger 2 /object/c 3        || return 1
+  [ `janosh -r get /object/c` -eq 3 ]       || return 1
+  janosh batch set 2.0 /object/d 1          && return 1
+  janosh batch set 3 /object/d 1            && return 1
+  janosh batch set 2x /object/d 1           && return 1
+  [ `janosh size /object/.` -eq 3 ]         || return 1
+}
+
+function test_paging() {
+  janosh mkarr /array/.                   || return 1
+  janosh append /array/. 0 1 2 3 4        || return 1
+  [ "`janosh -r get /array/. offset=1 limit=2 | tr '\n' ' '`" == "1 2 " ] || return 1
+  [ "`janosh -r get /array/. offset=3 | tr '\n' ' '`" == "3 4 " ] || return 1
+  [ "`janosh -r get /array/. reverse=true limit=2 | tr '\n' ' '`" == "4 3 " ] || return 1
+  [ -z "`janosh -r get /array/. offset=9`" ] || return 1
+  janosh get /array/. offset=-1           && return 1
+  janosh get /array/. limit=2x            && return 1 || return 0
+}
+
+function test_scan() {
+  janosh load "{\"array\":[`seq 0 2499 | sed 's/.*/{"v":&}/' | paste -sd,`],\"b\":1}" || return 1
+  [ `janosh -r get /array/. | wc -l` -eq 2500 ] || return 1
+  [ `janosh -r get /array/. | awk '{ s += $1 } END { print s }'` -eq 3123750 ] || return 1
+  [ `janosh -r get /array/. reverse=true limit=1` -eq 2499 ] || return 1
+  janosh remove /array/.                  || return 1
+  [ -z "`janosh dump | grep /array/`" ]   || return 1
+  [ `janosh -r get /b` -eq 1 ]            || return 1
+}
+
+function test_multiget() {
+  janosh load '{"object":{"a":{"x":1,"y":[2,3]},"c":4},"array":[{"n":"a"},[5]],"v":"x"}' || return 1
+  [ "`janosh -r get /object/. /v /array/.`" == "`janosh -r get /object/.; janosh -r get /v; janosh -r get /array/.`" ] || return 1
+  [ "`janosh -b get /object/. /v /array/.`" == "( `for p in /object/. /v /array/.; do janosh -b get $p | sed -e 's/^( //' -e 's/)$//'; done | tr -d '\n'`)" ] || return 1
+  [ "`janosh -j get /object/. /v /array/. | tr -d ' \n'`" == '{"object":{"a":{"x":1,"y":[2,3]},"c":4},"v":"x","array":[{"n":"a"},[5]]}' ] || return 1
+  janosh get /object/. /missing /array/.  && return 1 || return 0
+}
+
+function test_projection() {
+  janosh load '{"object":{"a":{"x":1,"y":2},"a-b":3,"c":4}}' || return 1
+  [ "`janosh -r get /object/. fields=a-b,c | tr '\n' ' '`" == "3 4 " ] || return 1
+  [ "`janosh -r get /object/. fields=a/x,a,a-b | tr '\n' ' '`" == "1 2 3 " ] || return 1
+  [ "`janosh -r get /object/. fields=a/y,c | tr '\n' ' '`" == "2 4 " ] || return 1
+  janosh load '{"array":[{"n":"a","v":0},{"n":"b","v":1}]}' || return 1
+  [ "`janosh -r get /array/. fields=n | tr '\n' ' '`" == "a b " ] || return 1
+  [ "`janosh -r get /array/. fields=v offset=1 | tr '\n' ' '`" == "1 " ] || return 1
+}
+
+function test_import() {
+  janosh import '{"array":[0,null,{"x":2}],"object":{"a":"b"}}' || return 1
+  [ `janosh size /array/.` -eq 3 ]             || return 1
+  [ `janosh -r get /array/#2/x` -eq 2 ]        || return 1
+  janosh import '{"c":[4,5]}' /target/.        || return 1
+  [ "`janosh -r get /target/c/. | tr '\n' ' '`" == "4 5 " ] || return 1
+  janosh import '{"c":1}' /target/.            && return 1
+  local file=`mktemp`
+  echo '{"d":"e"}' > "$file"
+  janosh import "$file" /file/.                || return 1
+  rm "$file"
+  [ "`janosh -r get /file/d`" == "e" ]         || return 1
+  janosh import '{"c":[1,' /broken/.           && return 1
+  [ `janosh size /.` -eq 4 ]                   || return 1
+}
+
+# records written by this version already use the current array index encoding
+# prints an array index in the legacy 64 character bitset encoding
+function legacy_index() {
+  local n=$1 bits=""
+  for i in `seq 64`; do
+    bits="$((n & 1))$bits"
+    n=$((n >> 1))
+  done
+  echo "\$$bits"
+}
+
+function test_migrate() {
+  janosh load '{"array":[0,1,2,3,4,5,6,7,8,9,10]}' || return 1
+  [ `janosh migrate` -eq 0 ]                   || return 1
+  [ `janosh -r get /array/#10` -eq 10 ]        || return 1
+  janosh migrate /array/.                      && return 1
+  janosh setraw /! O2 /legacy/! A3 /legacy/`legacy_index 0` n7 /legacy/`legacy_index 1`/! O1 \
+      /legacy/`legacy_index 1`/x sa /legacy/`legacy_index 2` n9 || return 1
+  local before="`janosh -j get /legacy/. /array/.`"
+  [ `janosh dump | grep -c "^path:/legacy/#"` -eq 4 ] || return 1
+  [ `janosh migrate` -eq 4 ]                   || return 1
+  [ `janosh migrate` -eq 0 ]                   || return 1
+  [ "`janosh -j get /legacy/. /array/.`" == "$before" ] || return 1
+  [ "`janosh -j get /legacy/. | tr -d ' \n'`" == '[7,{"x":"a"},9]' ] || return 1
+  [ `janosh -r get /legacy/#2` -eq 9 ]         || return 1
+}
+
+# the value cache statistics need the value cache the daemon started with -e has
+function test_stats() {
+  janosh mkobj /object/.                       || return 1
+  janosh add /object/value 1                   || return 1
+  janosh -r get /object/value > /dev/null      || return 1
+  local hits=`janosh stats | grep "^valuecache.hits " | cut -d" " -f2`
+  janosh -r get /object/value > /dev/null      || return 1
+  [ `janosh stats | grep "^valuecache.hits " | cut -d" " -f2` -gt $hits ] || return 1
+  [ `janosh stats | grep -c "^cursorpool\.\|^dircache\."` -eq 4 ] || return 1
+  janosh stats all                             && return 1 || return 0
+}
+
+# query and buildindex need the index /index/*/value. the daemon started with -e defines it.
+function test_query() {
+  janosh load '{"index":[{"value":9},{"value":10},{"value":-2.5},{"value":100},{"value":"x"}]}' || return 1
+  [ "`janosh query /index/*/value 0 50 | tr '\n' ' '`" == "/index/#0 /index/#1 " ] || return 1
+  [ "`janosh query /index/*/value -- -3 9 | tr '\n' ' '`" == "/index/#2 /index/#0 " ] || return 1
+  [ "`janosh query /index/*/value x`" == "/index/#4" ] || return 1
+  janosh add /index/#0/value 1                  && return 1
+  [ -z "`janosh query /index/*/value 1`" ]      || return 1
+  janosh remove /index/#0/.                     || return 1
+  [ "`janosh query /index/*/value 0 50`" == "/index/#0" ] || return 1
+  janosh set /index/#0/value 1000               || return 1
+  [ "`janosh query /index/*/value 1000`" == "/index/#0" ] || return 1
+  [ -z "`janosh query /index/*/value 10`" ]     || return 1
+}
+
+function test_buildindex() {
+  janosh load '{"index":[{"value":3},{"value":2},{"value":1}]}' || return 1
+  [ `janosh buildindex /index/*/value` -eq 3 ] || return 1
+  [ "`janosh query /index/*/value 1 2 | tr '\n' ' '`" == "/index/#2 /index/#1 " ] || return 1
+  janosh buildindex /missing/*/value           && return 1 || return 0
+}
+
+# runs a private daemon on an in-memory embedded db so no ktserver is needed
+function start_embedded() {
+  local dir=`mktemp -d`
+  mkdir "$dir/.janosh"
+  cat > "$dir/.janosh/janosh.json" <<EOF
+{
+  "maxThreads": "2",
+  "backend": "embedded",
+  "embeddedDb": "+",
+  "valueCacheCapacity": "1024",
+  "directoryCacheScope": "worker",
+  "indexes": "/index/*/value",
+  "sparseArrays": "/sparse",
+  "bindUrl": "$dir/janosh.sock",
+  "connectUrl": "$dir/janosh.sock"
+}
+EOF
+  export HOME="$dir"
+  janosh -d &> "$dir/janosh.log" &
+  local pid=$!
+  trap "kill $pid; wait $pid 2> /dev/null; rm -r '$dir'" EXIT
+  while [ ! -S "$dir/janosh.sock" ]; do
+    kill -0 $pid 2> /dev/null || { cat "$dir/janosh.log"; exit 1; }
+    sleep 0.1
+  done
+}
+
 function run() {
   ( 
     prepare
@@ -198,17 +423,20 @@ function run() {
 }
 
 
-while getopts 'dhv' c
+while getopts 'dhve' c
 do
   case $c in
     d) DEBUG=YES;;
     v) VERBOSE=YES;;
     h) HASH=YES;;
+    e) EMBEDDED=YES;;
     \?) echo "Unknown switch"; exit 1;;
   esac
 done
 
-shift
+shift $((OPTIND - 1))
+
+[ -n "$EMBEDDED" ] && start_embedded
 
 if [ -z "$1" ]; then
   run nested_transaction
@@ -218,10 +446,23 @@ if [ -z "$1" ]; then
   run set
   run add
   run remove
+  run sparse_remove
   run replace
   run copy
   run shift
   run shift_dir
+  run sparse_shift
+  run cache_coherence
+  run batch
+  run query
+  run buildindex
+  run paging
+  run scan
+  run projection
+  run multiget
+  run import
+  run migrate
+  run stats
 else
   run $1
 fi